@@ -0,0 +1,195 @@
+#ifndef RTIS_ARENA_ALLOCATOR
+#define RTIS_ARENA_ALLOCATOR
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace timed_executor
+{
+
+  /// Source of raw memory behind a ResourceAllocator, like std::pmr::memory_resource.
+  class MemoryResource
+  {
+  public:
+    virtual ~MemoryResource() = default;
+    virtual void *allocate(size_t bytes, size_t alignment) = 0;
+    virtual void deallocate(void *pointer, size_t bytes, size_t alignment) = 0;
+  };
+
+  /// The global operator new and delete.
+  class NewDeleteResource : public MemoryResource
+  {
+  public:
+    void *allocate(size_t bytes, size_t) override
+    {
+      return ::operator new(bytes);
+    }
+
+    void deallocate(void *pointer, size_t, size_t) override
+    {
+      ::operator delete(pointer);
+    }
+  };
+
+  inline MemoryResource *new_delete_resource()
+  {
+    static NewDeleteResource resource;
+    return &resource;
+  }
+
+  /// Bump allocation from one buffer allocated and touched up front.
+  /**
+   * Deallocation is a no-op, memory comes back when the arena is destroyed;
+   * containers that keep their capacity therefore stop allocating once they
+   * reached their peak size. When the buffer runs out the upstream resource
+   * serves the request and overflows() counts it, so size the arena from a run
+   * where that stayed 0. Safe to share between threads.
+   */
+  class MonotonicArena : public MemoryResource
+  {
+  public:
+    explicit MonotonicArena(size_t bytes, MemoryResource *upstream = new_delete_resource())
+        : upstream_(upstream), size_(bytes), buffer_(static_cast<char *>(upstream->allocate(bytes, alignof(std::max_align_t))))
+    {
+      // fault the pages in now rather than on the first allocations while spinning
+      std::memset(buffer_, 0, size_);
+    }
+
+    ~MonotonicArena() override
+    {
+      upstream_->deallocate(buffer_, size_, alignof(std::max_align_t));
+    }
+
+    MonotonicArena(const MonotonicArena &) = delete;
+    MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment) override
+    {
+      size_t offset = offset_.load(std::memory_order_relaxed);
+      while (true)
+      {
+        uintptr_t address = reinterpret_cast<uintptr_t>(buffer_) + offset;
+        size_t begin = offset + ((alignment - address % alignment) % alignment);
+        if (begin + bytes > size_)
+        {
+          overflows_.fetch_add(1, std::memory_order_relaxed);
+          return upstream_->allocate(bytes, alignment);
+        }
+        if (offset_.compare_exchange_weak(offset, begin + bytes, std::memory_order_relaxed))
+        {
+          return buffer_ + begin;
+        }
+      }
+    }
+
+    void deallocate(void *pointer, size_t bytes, size_t alignment) override
+    {
+      char *address = static_cast<char *>(pointer);
+      if (address < buffer_ || address >= buffer_ + size_)
+      {
+        upstream_->deallocate(pointer, bytes, alignment);
+      }
+    }
+
+    /// Bytes handed out from the buffer so far, including alignment padding.
+    size_t used() const
+    {
+      return offset_.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+      return size_;
+    }
+
+    /// Allocations the buffer could not serve.
+    size_t overflows() const
+    {
+      return overflows_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    MemoryResource *upstream_;
+    size_t size_;
+    char *buffer_;
+    std::atomic<size_t> offset_{0};
+    std::atomic<size_t> overflows_{0};
+  };
+
+  /// Standard allocator over a MemoryResource, new and delete unless given one.
+  /**
+   * The resource moves along when containers are copied, moved or swapped, so a
+   * container assigned from one built with an arena keeps using the arena.
+   */
+  template <typename T>
+  class ResourceAllocator
+  {
+  public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ResourceAllocator() noexcept : resource_(new_delete_resource())
+    {
+    }
+
+    ResourceAllocator(MemoryResource *resource) noexcept : resource_(resource)
+    {
+    }
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U> &other) noexcept : resource_(other.resource())
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+      return static_cast<T *>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *pointer, size_t n)
+    {
+      resource_->deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    MemoryResource *resource() const
+    {
+      return resource_;
+    }
+
+  private:
+    MemoryResource *resource_;
+  };
+
+  template <typename T, typename U>
+  bool operator==(const ResourceAllocator<T> &a1, const ResourceAllocator<U> &a2)
+  {
+    return a1.resource() == a2.resource();
+  }
+
+  template <typename T, typename U>
+  bool operator!=(const ResourceAllocator<T> &a1, const ResourceAllocator<U> &a2)
+  {
+    return a1.resource() != a2.resource();
+  }
+
+  /// The resource behind an allocator, new and delete for other allocator types.
+  template <typename Allocator>
+  MemoryResource *memory_resource_of(const Allocator &)
+  {
+    return new_delete_resource();
+  }
+
+  template <typename T>
+  MemoryResource *memory_resource_of(const ResourceAllocator<T> &allocator)
+  {
+    return allocator.resource();
+  }
+
+} // namespace timed_executor
+#endif
@@ -0,0 +1,40 @@
+#ifndef RTIS_CPU_TOPOLOGY
+#define RTIS_CPU_TOPOLOGY
+
+#include <string>
+#include <vector>
+
+namespace timed_executor
+{
+
+  /// One logical CPU as described by /sys/devices/system/cpu.
+  struct CpuInfo
+  {
+    int cpu = 0;
+    int core_id = 0;
+    int package_id = 0;
+    // lowest cpu sharing the last level cache, identifies the cache
+    int llc_id = 0;
+    bool isolated = false;
+    // usable by this process (sched_getaffinity)
+    bool allowed = true;
+  };
+
+  /// Parse a kernel cpu list such as "0-3,8,10-11".
+  std::vector<int> parse_cpu_list(const std::string &list);
+
+  /// Online CPUs with their core, package and last level cache.
+  std::vector<CpuInfo> read_cpu_topology(const std::string &root = "/sys/devices/system/cpu");
+
+  /// Pick count CPUs for worker threads.
+  /**
+   * Prefers one hardware thread per physical core, all under the last level
+   * cache with the most usable cores, and skips cpu 0 (interrupts and
+   * housekeeping) as well as isolated CPUs. Those are only fallen back to,
+   * SMT siblings first, when there are not enough CPUs; beyond that CPUs are
+   * reused.
+   */
+  std::vector<int> choose_worker_cpus(size_t count, const std::vector<CpuInfo> &topology);
+
+} // namespace timed_executor
+#endif
@@ -0,0 +1,120 @@
+#ifndef RTIS_DEADLINE_RING
+#define RTIS_DEADLINE_RING
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace timed_executor
+{
+
+  /// Fixed capacity FIFO, lock-free for one producer and one consumer thread.
+  /**
+   * The storage is allocated once by the constructor, rounded up to a power of
+   * two; push() fails instead of growing when the ring is full.
+   */
+  template <typename T, typename Allocator = std::allocator<T>>
+  class RingBuffer
+  {
+    using Traits = std::allocator_traits<Allocator>;
+
+  public:
+    explicit RingBuffer(size_t capacity, const Allocator &allocator = Allocator())
+        : mask_(round_up(capacity) - 1), allocator_(allocator), slots_(Traits::allocate(allocator_, mask_ + 1))
+    {
+      for (size_t i = 0; i <= mask_; ++i)
+      {
+        Traits::construct(allocator_, slots_ + i);
+      }
+    }
+
+    ~RingBuffer()
+    {
+      for (size_t i = 0; i <= mask_; ++i)
+      {
+        Traits::destroy(allocator_, slots_ + i);
+      }
+      Traits::deallocate(allocator_, slots_, mask_ + 1);
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /// Producer side, false if the ring is full.
+    bool push(const T &value)
+    {
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail - head_.load(std::memory_order_acquire) > mask_)
+      {
+        return false;
+      }
+      slots_[tail & mask_] = value;
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Consumer side, false if the ring is empty.
+    bool pop()
+    {
+      size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Consumer side, the oldest value; only valid if !empty().
+    const T &front() const
+    {
+      return slots_[head_.load(std::memory_order_acquire) & mask_];
+    }
+
+    /// Consumer side, the value at position from the oldest one; only valid below size().
+    T &at(size_t position)
+    {
+      return slots_[(head_.load(std::memory_order_acquire) + position) & mask_];
+    }
+
+    const T &at(size_t position) const
+    {
+      return slots_[(head_.load(std::memory_order_acquire) + position) & mask_];
+    }
+
+    bool empty() const
+    {
+      return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const
+    {
+      return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+      return mask_ + 1;
+    }
+
+  private:
+    static size_t round_up(size_t capacity)
+    {
+      size_t size = 1;
+      while (size < capacity)
+      {
+        size <<= 1;
+      }
+      return size;
+    }
+
+    // free running, the difference is the fill level
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    size_t mask_;
+    Allocator allocator_;
+    T *slots_;
+  };
+
+} // namespace timed_executor
+#endif
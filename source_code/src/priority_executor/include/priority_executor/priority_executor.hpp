@@ -23,7 +23,14 @@
 #include <memory>
 #include <vector>
 #include <time.h>
+#include <sched.h>
 #include <set>
+#include <map>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
 #include "rclcpp/executor.hpp"
 #include "rclcpp/macros.hpp"
 #include "rclcpp/memory_strategies.hpp"
@@ -32,6 +39,8 @@
 #include "rclcpp/rate.hpp"
 #include "rclcpp/visibility_control.hpp"
 #include "rclcpp/detail/mutex_two_priorities.hpp"
+#include "priority_executor/priority_memory_strategy.hpp"
+#include "priority_executor/ready_queue.hpp"
 using rclcpp::detail::MutexTwoPriorities;
 namespace timed_executor
 {
@@ -70,6 +79,9 @@ namespace timed_executor
 
     void set_use_priorities(bool use_prio);
 
+    /// Keep the wait set sized across waits and only rebuild it when the entity set changes.
+    void set_use_persistent_wait_set(bool use_persistent);
+
   private:
     RCLCPP_DISABLE_COPY(TimedExecutor)
     // TODO: remove these
@@ -78,14 +90,62 @@ namespace timed_executor
     int recording = 0;
     void execute_subscription(rclcpp::AnyExecutable subscription);
     bool
-    get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1));
+    get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1), DispatchInfo *info = nullptr);
     void
     wait_for_work(std::chrono::nanoseconds timeout);
 
     bool
-    get_next_ready_executable(rclcpp::AnyExecutable &any_executable);
+    get_next_ready_executable(rclcpp::AnyExecutable &any_executable, DispatchInfo *info = nullptr);
 
     bool use_priorities = true;
+    bool use_persistent_wait_set_ = false;
+  };
+
+  /// An executable released by the waiter thread, waiting for a worker.
+  struct ReadyExecutable
+  {
+    // held by pointer: AnyExecutable resets its callback group when destroyed
+    std::shared_ptr<rclcpp::AnyExecutable> executable;
+    // strategy id, sort key, absolute deadline (0 if it has none) and chain instance
+    DispatchInfo info;
+    uint64_t sequence = 0;
+  };
+
+  class ReadyExecutableComparator
+  {
+  public:
+    bool operator()(const ReadyExecutable &r1, const ReadyExecutable &r2) const
+    {
+      // the strategy's order: deadlines, then both kinds of priorities
+      if (r1.info.sort_key != r2.info.sort_key)
+      {
+        return r1.info.sort_key > r2.info.sort_key;
+      }
+      return r1.sequence > r2.sequence;
+    }
+  };
+
+  /// Real-time policy of a worker thread.
+  struct WorkerSchedParams
+  {
+    int policy = SCHED_FIFO; // SCHED_FIFO, SCHED_RR or SCHED_DEADLINE
+    int priority = 99;       // SCHED_FIFO and SCHED_RR
+    // SCHED_DEADLINE reservation, nanoseconds
+    uint64_t runtime = 0;
+    uint64_t deadline = 0;
+    uint64_t period = 0;
+  };
+
+  /// Released executables in the strategy's order, drained by one or more workers.
+  struct ReadyQueue
+  {
+    SpinLock lock;
+    std::condition_variable_any cv;
+    std::priority_queue<ReadyExecutable, std::vector<ReadyExecutable>, ReadyExecutableComparator> queue;
+    bool closed = false;
+    // readable by peers without taking the lock
+    std::atomic<size_t> size{0};
+    std::atomic<bool> idle{false};
   };
 
   class MultiThreadTimedExecutor : public rclcpp::Executor 
@@ -113,14 +173,85 @@ namespace timed_executor
 
       unsigned long long get_max_runtime(void);
       std::string name;
+      /// Cores for the worker threads, worker i runs on cpus[i % cpus.size()].
       std::vector<int> cpus;
       //void set_use_priorities(bool use_prio);
 
+      /// Place the workers from the /sys cpu topology when cpus is empty.
+      /**
+       * See choose_worker_cpus(). Without it, worker i runs on cpu i.
+       * The mapping in use is logged when spin() starts.
+       */
+      void set_automatic_cpu_placement(bool automatic);
+
+      /// Policy of every worker without its own, SCHED_FIFO 99 by default.
+      void set_worker_sched_params(const WorkerSchedParams &params);
+
+      void set_worker_sched_params(size_t thread_id, const WorkerSchedParams &params);
+
+      /// Give every worker a SCHED_DEADLINE reservation sized from the registered chains.
+      /**
+       * Uses the chain runtimes and periods of the PriorityMemoryStrategy (see
+       * set_executable_runtime()): a worker's period is the shortest period of the
+       * chains it runs, its runtime their utilization times that period times
+       * headroom. Partitioned workers count the chains assigned to them, otherwise
+       * the demand is split evenly. Explicit per-worker params take precedence.
+       * Deadline workers are not pinned: the kernel refuses SCHED_DEADLINE for a
+       * thread whose affinity is narrower than its root domain.
+       */
+      void set_deadline_reservations(bool reserve, double headroom = 1.2);
+
+      /// Let one thread own wait_for_work() and feed a ready queue in the strategy's order.
+      /**
+       * When enabled, spin() turns the calling thread into the waiter and starts
+       * number_of_threads workers that only pop from the ready queue, so rcl and
+       * the memory strategy are never touched by more than one thread.
+       */
+      void set_use_waiter_thread(bool use_waiter);
+
+      /// Keep the wait set sized across waits and only rebuild it when the entity set changes.
+      void set_use_persistent_wait_set(bool use_persistent);
+
+      /// Partitioned EDF: every chain is released to the ready queue of a single worker.
+      /**
+       * Implies the waiter thread. Each worker runs its own chains in deadline
+       * order and, with cpus set, stays on its own core. Chains go to worker
+       * chain_id % number_of_threads unless assign_chain_to_worker() says otherwise.
+       *
+       * The partitions share one wait set: the single waiter waits on every
+       * entity and routes each released executable to its chain's worker.
+       * Workers do not wait on their own entities, because the chain
+       * bookkeeping lives in the one memory strategy, and forks and joins
+       * release jobs across partitions. The waiter is the thread that called
+       * spin(). It keeps that thread's affinity, so pin it before spin() to
+       * keep it off the workers' cores. It runs with the default params, or
+       * with SCHED_FIFO 99 when the default is a deadline reservation.
+       */
+      void set_partitioned(bool partitioned);
+
+      void assign_chain_to_worker(int chain_id, size_t thread_id);
+
+      /// Let idle workers of the partitioned mode take the earliest deadline job of a busy peer.
+      void set_work_stealing(bool work_stealing);
+
+      /// Release to a MultiQueue instead of the single locked heap in the global waiter mode.
+      /**
+       * Workers pop without sharing a lock, at the price of relaxed EDF order:
+       * a worker may take one of the first few deadlines rather than the earliest.
+       */
+      void set_use_concurrent_ready_queue(bool use_concurrent);
+
     protected:
       RCLCPP_PUBLIC
       void
       run(size_t this_thread_number);
 
+      void
+      run_waiter();
+
+      void
+      run_worker(size_t this_thread_number);
+
     private:
       RCLCPP_DISABLE_COPY(MultiThreadTimedExecutor)
       rclcpp::detail::MutexTwoPriorities wait_mutex_;
@@ -129,17 +260,58 @@ namespace timed_executor
       std::chrono::nanoseconds next_exec_timeout_;
       std::set<rclcpp::TimerBase::SharedPtr> scheduled_timers_;
 
+      bool use_waiter_thread_ = false;
+      bool use_persistent_wait_set_ = false;
+      bool partitioned_ = false;
+      bool work_stealing_ = false;
+      bool use_concurrent_ready_queue_ = false;
+      std::unique_ptr<MultiQueue<ReadyExecutable>> concurrent_queue_;
+      // idle workers of the concurrent queue sleep here
+      std::mutex idle_mutex_;
+      std::condition_variable idle_cv_;
+      std::atomic<size_t> sleeping_workers_{0};
+      bool concurrent_queue_closed_ = false;
+      std::map<int, size_t> chain_workers_;
+      // one shared queue for global EDF, one per worker when partitioned
+      std::vector<std::unique_ptr<ReadyQueue>> ready_queues_;
+      std::mutex completed_mutex_;
+      // ids of the executables the workers finished, to be put back into the wait set by the waiter
+      std::vector<size_t> completed_;
+      uint64_t ready_sequence_ = 0;
+
+      size_t get_chain_worker(int chain_id);
+      bool is_work_stealing();
+      bool take_ready_executable(size_t thread_id, ReadyExecutable &ready);
+      bool take_concurrent_ready_executable(ReadyExecutable &ready);
+      bool has_stealable_work(size_t thread_id);
+      bool steal_ready_executable(size_t thread_id, ReadyExecutable &ready);
+      void wake_idle_worker(size_t busy_worker);
+
+      void notify_group_released(const rclcpp::AnyExecutable &any_executable);
+
+      bool automatic_cpu_placement_ = false;
+      std::vector<int> worker_cpus_;
+      void plan_worker_cpus();
+      void set_thread_affinity(size_t thread_id);
+      WorkerSchedParams default_sched_params_;
+      std::map<size_t, WorkerSchedParams> worker_sched_params_;
+      bool deadline_reservations_ = false;
+      double reservation_headroom_ = 1.2;
+      std::vector<WorkerSchedParams> planned_sched_params_;
+      void plan_worker_sched_params();
+      void set_thread_priority(const WorkerSchedParams &params);
+
       unsigned long long maxRuntime = 0;
       unsigned long long start_time = 0;
       int recording = 0;
       void execute_subscription(rclcpp::AnyExecutable subscription);
       bool
-      get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1));
+      get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1), DispatchInfo *info = nullptr);
       void
       wait_for_work(std::chrono::nanoseconds timeout);
 
       bool
-      get_next_ready_executable(rclcpp::AnyExecutable &any_executable);
+      get_next_ready_executable(rclcpp::AnyExecutable &any_executable, DispatchInfo *info = nullptr);
 
       //bool use_priorities = true;
   };
@@ -15,12 +15,20 @@
 #ifndef RTIS_PRIORITY_STRATEGY
 #define RTIS_PRIORITY_STRATEGY
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
 #include <vector>
 #include <queue>
+#include <unordered_map>
 #include <time.h>
 
 #include "rcl/allocator.h"
+#include "rcl/error_handling.h"
+#include "rcl/timer.h"
 
 #include "rclcpp/allocator/allocator_common.hpp"
 #include "rclcpp/memory_strategy.hpp"
@@ -31,8 +39,13 @@
 
 #include "rmw/types.h"
 
+#include "simple_timer/latency_histogram.hpp"
 #include "simple_timer/rt-sched.hpp"
 
+#include "priority_executor/arena_allocator.hpp"
+#include "priority_executor/deadline_ring.hpp"
+#include "priority_executor/ready_queue.hpp"
+
 /// Delegate for handling memory allocations while the Executor is executing.
 /**
  * By default, the memory strategy dynamically allocates memory for structures that come in from
@@ -57,35 +70,192 @@ enum ExecutableScheduleType
     DEFAULT, // not used here
 };
 
+// id of no registered executable
+constexpr size_t NO_EXECUTABLE_ID = SIZE_MAX;
+
+// instance number of no job
+constexpr uint64_t NO_JOB_INSTANCE = UINT64_MAX;
+
+/// One released instance of a chain.
+struct Job
+{
+    int chain_id = 0;
+    // numbered per chain in release order, from 0
+    uint64_t instance = NO_JOB_INSTANCE;
+    // absolute, see simple_timer::now_ns()
+    uint64_t release_time = 0;
+    uint64_t deadline = 0;
+    // stages of the chain dispatched for this instance so far
+    size_t stage = 0;
+};
+
+/// The released and not yet completed instances of a chain, oldest first.
+/**
+ * Owned by the PriorityMemoryStrategy and allocated with the chain, so
+ * releasing and completing instances does not allocate. Every stage counts the
+ * instances it ran and finds the job of the next one by number, so instances
+ * that overlap when the deadline exceeds the period stay apart.
+ */
+class ChainJobs
+{
+public:
+    int chain_id;
+    // nanoseconds, relative deadline of every instance
+    int64_t period;
+    int64_t deadline;
+    // chains released together with this one, see PriorityMemoryStrategy::fork_chain()
+    std::vector<ChainJobs *, timed_executor::ResourceAllocator<ChainJobs *>> branches;
+    // nanoseconds from release until the last stage returned, see PriorityMemoryStrategy::set_record_latencies()
+    simple_timer::LatencyHistogram response_time;
+
+    ChainJobs(int chain_id, int64_t period, int64_t deadline, size_t capacity,
+              timed_executor::MemoryResource *resource = timed_executor::new_delete_resource())
+        : chain_id(chain_id), period(period), deadline(deadline), branches(resource), jobs_(capacity, resource),
+          dependents_(resource)
+    {
+    }
+
+    /// Release the next instance, nullptr and counted in overflows() if too many are outstanding.
+    Job *release(uint64_t release_time)
+    {
+        Job job;
+        job.chain_id = chain_id;
+        job.instance = next_instance_;
+        job.release_time = release_time;
+        job.deadline = release_time + deadline;
+        if (!jobs_.push(job))
+        {
+            ++overflows_;
+            return nullptr;
+        }
+        ++next_instance_;
+        last_release_time_ = release_time;
+        return &jobs_.at(jobs_.size() - 1);
+    }
+
+    /// The outstanding job of an instance, nullptr if it completed or is not released yet.
+    Job *find(uint64_t instance)
+    {
+        uint64_t oldest = oldest_instance();
+        if (instance < oldest || instance >= next_instance_)
+        {
+            return nullptr;
+        }
+        return &jobs_.at(instance - oldest);
+    }
+
+    const Job *find(uint64_t instance) const
+    {
+        return const_cast<ChainJobs *>(this)->find(instance);
+    }
+
+    /// Complete the instance along with every older one still outstanding.
+    void complete(uint64_t instance)
+    {
+        while (!jobs_.empty() && jobs_.front().instance <= instance)
+        {
+            jobs_.pop();
+        }
+    }
+
+    /// The instance of the oldest outstanding job, or the next one to release.
+    uint64_t oldest_instance() const
+    {
+        return next_instance_ - jobs_.size();
+    }
+
+    uint64_t last_release_time() const
+    {
+        return last_release_time_;
+    }
+
+    /// The instance release() gives out next.
+    uint64_t next_instance() const
+    {
+        return next_instance_;
+    }
+
+    /// Releases dropped so far because the ring of outstanding instances was full.
+    uint64_t overflows() const
+    {
+        return overflows_;
+    }
+
+    size_t size() const
+    {
+        return jobs_.size();
+    }
+
+    /// The outstanding job at position from the oldest one.
+    const Job &at(size_t position) const
+    {
+        return jobs_.at(position);
+    }
+
+    /// Re-key executable id whenever this chain releases or completes an instance.
+    void add_dependent(size_t id)
+    {
+        if (std::find(dependents_.begin(), dependents_.end(), id) == dependents_.end())
+        {
+            dependents_.push_back(id);
+        }
+    }
+
+    void remove_dependent(size_t id)
+    {
+        dependents_.erase(std::remove(dependents_.begin(), dependents_.end(), id), dependents_.end());
+    }
+
+    /// Ids of the stages of this chain and of the joins it feeds.
+    const std::vector<size_t, timed_executor::ResourceAllocator<size_t>> &dependents() const
+    {
+        return dependents_;
+    }
+
+private:
+    timed_executor::RingBuffer<Job, timed_executor::ResourceAllocator<Job>> jobs_;
+    uint64_t next_instance_ = 0;
+    uint64_t last_release_time_ = 0;
+    uint64_t overflows_ = 0;
+    std::vector<size_t, timed_executor::ResourceAllocator<size_t>> dependents_;
+};
+
 class PriorityExecutable
 {
 public:
     std::shared_ptr<const void> handle;
+    // dense index given by the strategy at registration, see ExecutableStateTable
+    size_t id = NO_EXECUTABLE_ID;
     ExecutableType type;
-    bool can_be_run = true;
     std::shared_ptr<rclcpp::Waitable> waitable;
-    ExecutableScheduleType sched_type;
+    ExecutableScheduleType sched_type = CHAIN_INDEPENDENT_PRIORITY;
 
-    int priority;
-    long period = 1000; // milliseconds
-    long deadline = 1000;
-    //double_t runtime;
-    long *release_time = nullptr; // for timer_handle
+    int priority = 0;
+    int64_t period = 1000000000; // nanoseconds
+    int64_t deadline = 1000000000;
+    int64_t runtime = 0; // nanoseconds, worst case estimate, 0 if unknown
+
+    // left out of the wait set, e.g. while queued or running on another thread
+    bool excluded = false;
+    // chain fusion: id of the subscription run right after this one, on the same thread
+    size_t chain_successor = NO_EXECUTABLE_ID;
+    // run by its predecessor instead of being waited on, unless the last direct take missed
+    bool fused = false;
+    bool fusion_missed = false;
 
     bool is_first_in_chain = false;
     bool is_last_in_chain = false;
-    // chain aware deadlines
-    int *cur_index = nullptr;
-    std::vector<std::deque<uint> *> *deadlines = nullptr;
+    // released instances of the chain, shared by its stages
+    ChainJobs *jobs = nullptr;
+    // join stages: the chains joined instead of jobs, and the instance run next of each
+    // on the strategy's MemoryResource once set_join_inputs() filled them
+    std::vector<ChainJobs *, timed_executor::ResourceAllocator<ChainJobs *>> join_inputs;
+    std::vector<uint64_t, timed_executor::ResourceAllocator<uint64_t>> join_instances;
     std::shared_ptr<rclcpp::TimerBase> timer_handle;
     // just used for logging
     int chain_id = 0;
 
-    // chain aware priority
-    int counter = 0;
-
-    // The number of release of the chain
-    long long *sum = nullptr; 
+    // p is the priority, or the period in milliseconds for DEADLINE
     PriorityExecutable(std::shared_ptr<const void> h, int p, ExecutableType t, ExecutableScheduleType sched_type = CHAIN_INDEPENDENT_PRIORITY)
     {
         handle = h;
@@ -96,11 +266,9 @@ public:
         }
         else if (sched_type == DEADLINE)
         {
-            period = p;
+            period = std::chrono::nanoseconds(std::chrono::milliseconds(p)).count();
         }
         this->sched_type = sched_type;
-        this->sum = new long long(0);
-        this->cur_index = new int(0);
     }
 
     PriorityExecutable(std::shared_ptr<const void> h, int p, int d, ExecutableType t, ExecutableScheduleType sched_type = CHAIN_INDEPENDENT_PRIORITY)
@@ -113,152 +281,191 @@ public:
         }
         else if (sched_type == DEADLINE)
         {
-            period = p;
-            deadline = d;
+            period = std::chrono::nanoseconds(std::chrono::milliseconds(p)).count();
+            deadline = std::chrono::nanoseconds(std::chrono::milliseconds(d)).count();
         }
         this->sched_type = sched_type;
-        this->sum = new long long(0);
-        this->cur_index = new int(0);
     }
-    void dont_run()
+
+    PriorityExecutable(std::shared_ptr<const void> h, std::chrono::nanoseconds p, std::chrono::nanoseconds d, ExecutableType t)
     {
-        this->can_be_run = false;
+        handle = h;
+        type = t;
+        period = p.count();
+        deadline = d.count();
+        this->sched_type = DEADLINE;
     }
-
-    void allow_run()
+    bool is_waited_on() const
     {
-        if (this->can_be_run)
-        {
-            // release has been detected
-        }
-        else
-        {
-            this->can_be_run = true;
-        }
+        return !excluded && (!fused || fusion_missed);
     }
 
     PriorityExecutable()
     {
         handle = nullptr;
-        priority = 0;
         type = SUBSCRIPTION;
-        sum = new long long(0);
+    }
+};
+
+/// Scheduling state that changes while spinning, one entry per PriorityExecutable::id.
+/**
+ * Kept in contiguous arrays apart from the settings, so ordering the ready
+ * executables reads a few cache lines instead of chasing every executable and
+ * its deadline queue.
+ */
+template <typename Alloc = std::allocator<void>>
+struct ExecutableStateTable
+{
+    template <typename T>
+    using Vector = std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>>;
+
+    explicit ExecutableStateTable(const Alloc &allocator = Alloc())
+        : chain_id(allocator), sort_key(allocator), counter(allocator), releases(allocator), instance(allocator)
+    {
+    }
+
+    Vector<int> chain_id;
+    // order among the ready executables, computed when marked ready, see make_sort_key()
+    Vector<uint64_t> sort_key;
+    // the number of times a chain aware or deadline executable was dispatched
+    Vector<int> counter;
+    // the number of releases
+    Vector<long long> releases;
+    // the chain instance (Job::instance) a deadline executable runs next
+    Vector<uint64_t> instance;
+
+    void resize(size_t size)
+    {
+        chain_id.resize(size, 0);
+        sort_key.resize(size, 0);
+        counter.resize(size, 0);
+        releases.resize(size, 0);
+        instance.resize(size, 0);
     }
 
-    void increment_counter()
+    /// Start over from the settings of a (re-)registered executable.
+    void reset(const PriorityExecutable &exec)
     {
-        this->counter += 1;
+        chain_id[exec.id] = exec.chain_id;
+        sort_key[exec.id] = 0;
+        counter[exec.id] = 0;
+        releases[exec.id] = 0;
+        instance[exec.id] = 0;
     }
 };
 
+/// Orders ids by their precomputed sort key, for heaps with the std::priority_queue meaning.
+template <typename StateTable = ExecutableStateTable<>>
 class PriorityExecutableComparator
 {
 public:
-    bool operator()(const PriorityExecutable *p1, const PriorityExecutable *p2)
+    explicit PriorityExecutableComparator(const StateTable *state = nullptr) : state_(state)
     {
-        if (p1 == nullptr || p2 == nullptr)
-        {
-            // TODO: realistic value
-            return 0;
-        }
-        if (p1->sched_type != p2->sched_type)
-        {
-            if (p1->sched_type == DEADLINE)
-            {
-                return false;
-            }
-            else if (p2->sched_type == DEADLINE)
-            {
-                return true;
-            }
-            if (p1->sched_type == CHAIN_INDEPENDENT_PRIORITY)
-            {
-                return false;
-            }
-            else if (p2->sched_type == CHAIN_INDEPENDENT_PRIORITY)
-            {
-                return true;
-            }
-            else if (p1->sched_type == CHAIN_AWARE_PRIORITY)
-            {
-                return false;
-            }
-            else
-            {
-                return true;
-            }
-        }
-        if (p1->sched_type == CHAIN_INDEPENDENT_PRIORITY)
-        {
-            // lower value runs first
-            return p1->priority > p2->priority;
-        }
-        if (p1->sched_type == CHAIN_AWARE_PRIORITY)
-        {
-            if (p1->priority != p2->priority)
-            {
-                return p1->priority < p2->priority;
-            }
-            // return p1->counter > p2->counter;
-            return 0;
-        }
-        if (p1->sched_type == DEADLINE)
-        {
-            // TODO: use the counter logic here as well
+    }
 
-            uint p1_deadline = 0;
-            uint p2_deadline = 0;
-            if (p1->deadlines != nullptr && !(*p1->deadlines)[*p1->cur_index]->empty())
-            {
-                p1_deadline = (*p1->deadlines)[*p1->cur_index]->front();
-            }
-            if (p2->deadlines != nullptr && !(*p2->deadlines)[*p2->cur_index]->empty())
-            {
-                p2_deadline = (*p2->deadlines)[*p2->cur_index]->front();
-            }
-            if (p1_deadline == 0)
-            {
-                return true;
-            }
-            if (p2_deadline == 0)
-            {
-                return false;
-            }
-            if (p1_deadline == p2_deadline)
-            {
-                // these must be from the same chain
-                // settle the difference with the counter
-                return p1->counter > p2->counter;
-            }
-            return p1_deadline > p2_deadline;
-        }
-        else
-        {
-            std::cout << "invalid compare opration on priority_exec" << std::endl;
-            return 0;
-        }
+    bool operator()(size_t id1, size_t id2) const
+    {
+        // the larger key runs later
+        return state_->sort_key[id1] > state_->sort_key[id2];
     }
+
+private:
+    const StateTable *state_;
 };
-template <typename Alloc = std::allocator<void>>
+
+/// Execution demand of one chain, summed over its stages.
+struct ChainDemand
+{
+    int64_t runtime = 0; // nanoseconds per period
+    int64_t period = 0;  // nanoseconds
+};
+
+/// Scheduling attributes of an executable, captured when it is handed out.
+struct DispatchInfo
+{
+    // absolute deadline of the chain instance, 0 for non-deadline executables
+    uint64_t deadline = 0;
+    // Job::instance of the chain, NO_JOB_INSTANCE for non-deadline executables
+    uint64_t instance = NO_JOB_INSTANCE;
+    // Job::release_time of the instance, 0 for non-deadline executables
+    uint64_t release_time = 0;
+    // set by PriorityMemoryStrategy::dispatch_started(), see simple_timer::now_ns()
+    uint64_t start_time = 0;
+    int chain_id = 0;
+    size_t id = NO_EXECUTABLE_ID;
+    // its order among the ready executables when it was handed out, see make_sort_key()
+    uint64_t sort_key = UINT64_MAX;
+    // running it completes the chain instance
+    bool last_in_chain = false;
+    // chain fusion runs a successor right after it, see set_chain_successor()
+    bool has_chain_successor = false;
+};
+
+/// Latencies of one executable in nanoseconds, see PriorityMemoryStrategy::set_record_latencies().
+struct ExecutableLatencies
+{
+    simple_timer::LatencyHistogram execution_time;
+    // from the release of the chain instance until it started, deadline executables only
+    simple_timer::LatencyHistogram release_latency;
+};
+
+/// Memory strategy scheduling by chain deadlines and priorities.
+/**
+ * Every container and the per-executable state are allocated through Alloc;
+ * the chain jobs, fork branches and join inputs, which are not templated on
+ * it, use its MemoryResource, or new and delete for other allocator types.
+ * The default ResourceAllocator uses new and delete unless constructed with a
+ * resource such as a timed_executor::MonotonicArena, which keeps steady-state
+ * spinning away from malloc.
+ */
+template <typename Alloc = timed_executor::ResourceAllocator<void>>
 class PriorityMemoryStrategy : public rclcpp::memory_strategy::MemoryStrategy
 {
 public:
     RCLCPP_SMART_PTR_DEFINITIONS(PriorityMemoryStrategy<Alloc>)
 
+    /// Job releases, dispatches and deadline misses are traced once made by create_logger().
     node_time_logger logger;
-    bool is_f1tenth = false;
 
     using VoidAllocTraits = typename rclcpp::allocator::AllocRebind<void *, Alloc>;
     using VoidAlloc = typename VoidAllocTraits::allocator_type;
 
     explicit PriorityMemoryStrategy(std::shared_ptr<Alloc> allocator)
+        : guard_conditions_(*allocator),
+          subscription_handles_(*allocator),
+          service_handles_(*allocator),
+          client_handles_(*allocator),
+          timer_handles_(*allocator),
+          waitable_handles_(*allocator),
+          subscription_execs_(*allocator),
+          service_execs_(*allocator),
+          client_execs_(*allocator),
+          timer_execs_(*allocator),
+          waitable_execs_(*allocator),
+          node_guard_conditions_(*allocator),
+          cached_groups_(*allocator),
+          cached_group_nodes_(*allocator),
+          group_can_be_taken_(*allocator),
+          cached_subscriptions_(*allocator),
+          cached_services_(*allocator),
+          cached_clients_(*allocator),
+          cached_timers_(*allocator),
+          cached_waitables_(*allocator),
+          resolved_(*allocator),
+          executable_ids_(*allocator),
+          executables_(*allocator),
+          latencies_(*allocator),
+          state_(*allocator),
+          all_executables_(Comparator(&state_), *allocator),
+          skipped_ids_(*allocator),
+          chain_jobs_(*allocator)
     {
         allocator_ = std::make_shared<VoidAlloc>(*allocator.get());
     }
 
     PriorityMemoryStrategy()
+        : PriorityMemoryStrategy(std::make_shared<Alloc>())
     {
-        allocator_ = std::make_shared<VoidAlloc>();
     }
 
     void add_guard_condition(const rcl_guard_condition_t *guard_condition) override
@@ -271,6 +478,8 @@ public:
             }
         }
         guard_conditions_.push_back(guard_condition);
+        // the executor adds a guard condition for every node it is given
+        invalidate_entity_cache();
     }
 
     void remove_guard_condition(const rcl_guard_condition_t *guard_condition) override
@@ -280,9 +489,183 @@ public:
             if (*it == guard_condition)
             {
                 guard_conditions_.erase(it);
+                invalidate_entity_cache();
+                break;
+            }
+        }
+    }
+
+    /// Leave an executable out of the wait set until it is included again.
+    void set_excluded(size_t id, bool excluded)
+    {
+        PriorityExecutable *exec = get_executable(id);
+        if (exec != nullptr && exec->excluded != excluded)
+        {
+            exec->excluded = excluded;
+            handles_dirty_ = true;
+        }
+    }
+
+    void set_excluded(std::shared_ptr<const void> handle, bool excluded)
+    {
+        set_excluded(get_executable_id(handle), excluded);
+    }
+
+    /// Run the subscription successor on the thread that finished predecessor, skipping the wait set.
+    /**
+     * Only valid when successor's sole trigger is a message published by predecessor's
+     * callback. Executors then take its message right after predecessor returns; when
+     * that take misses, successor is waited on again until it has run once.
+     */
+    void set_chain_successor(std::shared_ptr<const void> predecessor, std::shared_ptr<const void> successor)
+    {
+        PriorityExecutable *pred_exec = get_priority_settings(predecessor);
+        PriorityExecutable *succ_exec = get_priority_settings(successor);
+        if (pred_exec == nullptr || succ_exec == nullptr || succ_exec->type != SUBSCRIPTION)
+        {
+            throw std::runtime_error("set_chain_successor: both executables need settings, the successor must be a subscription");
+        }
+        pred_exec->chain_successor = succ_exec->id;
+        succ_exec->fused = true;
+        handles_dirty_ = true;
+    }
+
+    /// Id of the successor to run right after id, if it is not waiting for a missed message.
+    size_t get_chain_successor(size_t id)
+    {
+        PriorityExecutable *exec = get_executable(id);
+        if (exec == nullptr || exec->chain_successor == NO_EXECUTABLE_ID)
+        {
+            return NO_EXECUTABLE_ID;
+        }
+        if (executables_[exec->chain_successor].fusion_missed)
+        {
+            return NO_EXECUTABLE_ID;
+        }
+        return exec->chain_successor;
+    }
+
+    /// Fill any_exec with the successor subscription and take its callback group.
+    /**
+     * \return false if the group is busy, the successor is then waited on again
+     */
+    bool claim_chain_successor(
+        size_t successor,
+        rclcpp::AnyExecutable &any_exec,
+        const WeakNodeList &weak_nodes)
+    {
+        rclcpp::CallbackGroup::SharedPtr group;
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base;
+        auto subscription = resolve<rclcpp::SubscriptionBase>(
+            successor, weak_nodes, group, node_base,
+            [&]()
+            { return get_subscription_by_handle(std::static_pointer_cast<const rcl_subscription_t>(executables_[successor].handle), weak_nodes); },
+            [&](const rclcpp::SubscriptionBase::SharedPtr &entity)
+            { return get_group_by_subscription(entity, weak_nodes); });
+        bool claimed = subscription != nullptr && group != nullptr;
+        if (claimed && group->type() == rclcpp::CallbackGroupType::MutuallyExclusive)
+        {
+            // a sibling may be running on another thread
+            bool can_be_taken = true;
+            claimed = group->can_be_taken_from().compare_exchange_strong(can_be_taken, false);
+        }
+        if (!claimed)
+        {
+            finish_chain_successor(successor, false);
+            return false;
+        }
+        any_exec.subscription = subscription;
+        any_exec.callback_group = group;
+        any_exec.node_base = node_base;
+        return true;
+    }
+
+    /// Record the outcome of the direct take of a claimed successor.
+    void finish_chain_successor(size_t successor, bool taken, DispatchInfo *info = nullptr)
+    {
+        PriorityExecutable *exec = get_executable(successor);
+        if (exec == nullptr)
+        {
+            return;
+        }
+        if (taken)
+        {
+            on_dispatch(exec, info);
+        }
+        else
+        {
+            exec->fusion_missed = true;
+            handles_dirty_ = true;
+        }
+    }
+
+    /// Time until the next timer release or pending chain deadline.
+    /**
+     * \return a negative duration when no timer is armed and no deadline is pending
+     */
+    std::chrono::nanoseconds get_next_wakeup_timeout()
+    {
+        int64_t timeout = -1;
+        for (auto &entity : cached_timers_)
+        {
+            // a timer that is not waited on would wake us up for nothing
+            if (!group_can_be_taken_[entity.group_index] || !entity.exec->is_waited_on())
+            {
+                continue;
+            }
+            int64_t time_until_next_call = 0;
+            if (rcl_timer_get_time_until_next_call(entity.handle.get(), &time_until_next_call) != RCL_RET_OK)
+            {
+                // canceled timers are not going to fire
+                rcl_reset_error();
+                continue;
+            }
+            if (time_until_next_call < 0)
+            {
+                time_until_next_call = 0;
+            }
+            if (timeout < 0 || time_until_next_call < timeout)
+            {
+                timeout = time_until_next_call;
+            }
+        }
+
+        // chains share their jobs with the timer that starts them
+        uint64_t now = simple_timer::now_ns();
+        for (auto &entity : cached_timers_)
+        {
+            const PriorityExecutable *exec = entity.exec;
+            if (exec->sched_type != DEADLINE || exec->jobs == nullptr)
+            {
+                continue;
+            }
+            // deadlines grow with the instance, the first one ahead is the closest
+            for (size_t i = 0; i < exec->jobs->size(); ++i)
+            {
+                uint64_t deadline = exec->jobs->at(i).deadline;
+                if (deadline <= now)
+                {
+                    continue;
+                }
+                int64_t time_until_deadline = deadline - now;
+                if (timeout < 0 || time_until_deadline < timeout)
+                {
+                    timeout = time_until_deadline;
+                }
                 break;
             }
         }
+        return std::chrono::nanoseconds(timeout);
+    }
+
+    /// Force the next collect_entities() to walk the nodes again.
+    /**
+     * Happens by itself when a node is added or removed, and when the notify
+     * guard condition of a node fires because it created entities or groups.
+     */
+    void invalidate_entity_cache()
+    {
+        entity_cache_valid_ = false;
     }
 
     void clear_handles() override
@@ -292,14 +675,70 @@ public:
         client_handles_.clear();
         timer_handles_.clear();
         waitable_handles_.clear();
+        subscription_execs_.clear();
+        service_execs_.clear();
+        client_execs_.clear();
+        timer_execs_.clear();
+        waitable_execs_.clear();
+        handles_dirty_ = true;
+    }
+
+    /// Refresh the handle lists for a wait set that is kept across waits.
+    /**
+     * Replaces clear_handles() + collect_entities(): the handle lists are only rebuilt when
+     * the entity cache or the availability of a callback group changed, and are left intact
+     * by mark_ready_handles(), so an unchanged entity set costs no allocation.
+     */
+    bool refresh_handles(const WeakNodeList &weak_nodes)
+    {
+        bool has_invalid_weak_nodes = has_expired_nodes(weak_nodes);
+        bool rebuilt = has_invalid_weak_nodes || !entity_cache_valid_;
+        if (rebuilt)
+        {
+            rebuild_entity_cache(weak_nodes);
+        }
+        bool groups_changed = update_group_availability();
+        if (rebuilt || groups_changed || handles_dirty_)
+        {
+            subscription_handles_.clear();
+            service_handles_.clear();
+            client_handles_.clear();
+            timer_handles_.clear();
+            waitable_handles_.clear();
+            subscription_execs_.clear();
+            service_execs_.clear();
+            client_execs_.clear();
+            timer_execs_.clear();
+            waitable_execs_.clear();
+            fill_handles();
+            handles_dirty_ = false;
+        }
+        return has_invalid_weak_nodes;
+    }
 
-        // priority_queue doesn't have a clear function, so we swap it with an empty one. `empty` will go out of scope, and be cleared
-        // all_executables_ = std::priority_queue<const PriorityExecutable *, std::vector<const PriorityExecutable *>, PriorityExecutableComparator>();
-        std::priority_queue<const PriorityExecutable *, std::vector<const PriorityExecutable *>, PriorityExecutableComparator> empty;
-        std::swap(all_executables_, empty);
-        if (!all_executables_.empty())
+    /// Counterpart of remove_null_handles() for refresh_handles(), keeps the handle lists.
+    void mark_ready_handles(rcl_wait_set_t *wait_set)
+    {
+        check_node_guard_conditions(wait_set);
+        for (size_t i = 0; i < subscription_handles_.size(); ++i)
+        {
+            mark_ready(subscription_execs_[i], wait_set->subscriptions[i] != nullptr);
+        }
+        for (size_t i = 0; i < service_handles_.size(); ++i)
+        {
+            mark_ready(service_execs_[i], wait_set->services[i] != nullptr);
+        }
+        for (size_t i = 0; i < client_handles_.size(); ++i)
+        {
+            mark_ready(client_execs_[i], wait_set->clients[i] != nullptr);
+        }
+        for (size_t i = 0; i < timer_handles_.size(); ++i)
+        {
+            mark_ready(timer_execs_[i], wait_set->timers[i] != nullptr);
+        }
+        for (size_t i = 0; i < waitable_execs_.size(); ++i)
         {
-            std::cout << "couldn't clear all exec" << std::endl;
+            mark_ready(waitable_execs_[i], waitable_handles_[i]->is_ready(wait_set));
         }
     }
 
@@ -311,67 +750,55 @@ public:
         // Important to use subscription_handles_.size() instead of wait set's size since
         // there may be more subscriptions in the wait set due to Waitables added to the end.
         // The same logic applies for other entities.
+        check_node_guard_conditions(wait_set);
         for (size_t i = 0; i < subscription_handles_.size(); ++i)
         {
+            mark_ready(subscription_execs_[i], wait_set->subscriptions[i] != nullptr);
             if (!wait_set->subscriptions[i])
             {
-                priority_map[subscription_handles_[i]].dont_run();
                 subscription_handles_[i].reset();
             }
-            else
-            {
-                priority_map[subscription_handles_[i]].allow_run();
-            }
         }
         for (size_t i = 0; i < service_handles_.size(); ++i)
         {
+            mark_ready(service_execs_[i], wait_set->services[i] != nullptr);
             if (!wait_set->services[i])
             {
-                priority_map[service_handles_[i]].dont_run();
                 service_handles_[i].reset();
             }
-            else
-            {
-                priority_map[service_handles_[i]].allow_run();
-            }
         }
         for (size_t i = 0; i < client_handles_.size(); ++i)
         {
+            mark_ready(client_execs_[i], wait_set->clients[i] != nullptr);
             if (!wait_set->clients[i])
             {
-                priority_map[client_handles_[i]].dont_run();
                 client_handles_[i].reset();
             }
-            else
-            {
-                priority_map[client_handles_[i]].allow_run();
-            }
         }
         for (size_t i = 0; i < timer_handles_.size(); ++i)
         {
+            mark_ready(timer_execs_[i], wait_set->timers[i] != nullptr);
             if (!wait_set->timers[i])
             {
-                priority_map[timer_handles_[i]].dont_run();
                 timer_handles_[i].reset();
             }
-            else
-            {
-                priority_map[timer_handles_[i]].allow_run();
-            }
         }
         for (size_t i = 0; i < waitable_handles_.size(); ++i)
         {
-            if (!waitable_handles_[i]->is_ready(wait_set))
+            // waitables given through add_waitable_handle() were not collected
+            PriorityExecutable *exec = i < waitable_execs_.size() ? waitable_execs_[i] : get_priority_settings(waitable_handles_[i]);
+            bool ready = waitable_handles_[i]->is_ready(wait_set);
+            if (exec != nullptr)
             {
-                priority_map[waitable_handles_[i]].dont_run();
-                waitable_handles_[i].reset();
+                mark_ready(exec, ready);
             }
-            else
+            if (!ready)
             {
-                priority_map[waitable_handles_[i]].allow_run();
+                waitable_handles_[i].reset();
             }
         }
 
+        handles_dirty_ = true;
         subscription_handles_.erase(
             std::remove(subscription_handles_.begin(), subscription_handles_.end(), nullptr),
             subscription_handles_.end());
@@ -395,94 +822,13 @@ public:
 
     bool collect_entities(const WeakNodeList &weak_nodes) override
     {
-        bool has_invalid_weak_nodes = false;
-        for (auto &weak_node : weak_nodes)
+        bool has_invalid_weak_nodes = has_expired_nodes(weak_nodes);
+        if (has_invalid_weak_nodes || !entity_cache_valid_)
         {
-            auto node = weak_node.lock();
-            if (!node)
-            {
-                has_invalid_weak_nodes = true;
-                continue;
-            }
-            for (auto &weak_group : node->get_callback_groups())
-            {
-                auto group = weak_group.lock();
-                if (!group || !group->can_be_taken_from().load())
-                {
-                    continue;
-                }
-                group->find_subscription_ptrs_if(
-                    [this](const rclcpp::SubscriptionBase::SharedPtr &subscription)
-                    {
-                        auto subscription_handle = subscription->get_subscription_handle();
-                        PriorityExecutable *t = get_priority_settings(subscription_handle);
-                        if(t == nullptr) return false;
-                        //std::cout << (t == nullptr ? "yes" : "no") << std::endl;
-                        subscription_handles_.push_back(subscription_handle);
-                        all_executables_.push(get_and_reset_priority(subscription_handle, SUBSCRIPTION));
-                        //std::cout << "-----------------" << std::endl;
-                        //PriorityExecutable *t = get_and_reset_priority(subscription_handle, SUBSCRIPTION);
-                        //std::cout << "chain_id: " << t->chain_id;
-                        //std::cout << " sched_type: " << t->sched_type << std::endl;
-                        return false;
-                    });
-                group->find_service_ptrs_if(
-                    [this](const rclcpp::ServiceBase::SharedPtr &service)
-                    {
-                        auto service_handle = service->get_service_handle();
-                        PriorityExecutable *t = get_priority_settings(service_handle);
-                        if(t == nullptr) return false;
-                        all_executables_.push(get_and_reset_priority(service->get_service_handle(), SERVICE));
-                        service_handles_.push_back(service->get_service_handle());
-                        return false;
-                    });
-                group->find_client_ptrs_if(
-                    [this](const rclcpp::ClientBase::SharedPtr &client)
-                    {
-                        all_executables_.push(get_and_reset_priority(client->get_client_handle(), CLIENT));
-                        client_handles_.push_back(client->get_client_handle());
-                        return false;
-                    });
-                group->find_timer_ptrs_if(
-                    [this](const rclcpp::TimerBase::SharedPtr &timer)
-                    {
-                        /*
-                        auto timer_handle = timer->get_timer_handle();
-                        PriorityExecutable *t = get_priority_settings(timer_handle);
-                        
-                        std::cout << "chain_id: " << t->chain_id << " deadlines size: " << t->deadlines->size() << std::endl;
-
-                        timespec current_time;
-                        clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                        uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-                        uint64_t time_until_trigger = timer->time_until_trigger().count() / 1000000;
-                        uint64_t release_time = millis + time_until_trigger;
-                        std::cout << "release_time: " << release_time << " current_time: " << millis << " time_until_trigger: " << time_until_trigger <<std::endl;
-                        t->deadlines->push_back(release_time + t->period);
-                        
-                        if (is_f1tenth && t->chain_id == 0) {
-                            for(auto it : priority_map) {
-                                if (it.second.chain_id == 1) {
-                                    std::cout << "chain_id: 1" << " deadlines size: " << it.second.deadlines->size() << std::endl;
-                                    it.second.deadlines->push_back(release_time + it.second.period);
-                                    break;
-                                }
-                            }
-                        }
-                        */
-                        all_executables_.push(get_and_reset_priority(timer->get_timer_handle(), TIMER));
-                        timer_handles_.push_back(timer->get_timer_handle());
-                        return false;
-                    });
-                group->find_waitable_ptrs_if(
-                    [this](const rclcpp::Waitable::SharedPtr &waitable)
-                    {
-                        all_executables_.push(get_and_reset_priority(waitable, WAITABLE));
-                        waitable_handles_.push_back(waitable);
-                        return false;
-                    });
-            }
+            rebuild_entity_cache(weak_nodes);
         }
+        update_group_availability();
+        fill_handles();
         return has_invalid_weak_nodes;
     }
 
@@ -492,6 +838,8 @@ public:
         {
             throw std::runtime_error("waitable object unexpectedly nullptr");
         }
+        // registered here, the wait set results are matched without inserting
+        get_and_reset_priority(waitable, WAITABLE)->waitable = waitable;
         waitable_handles_.push_back(waitable);
     }
 
@@ -569,194 +917,172 @@ public:
     void
     get_next_executable(
         rclcpp::AnyExecutable &any_exec,
-        const WeakNodeList &weak_nodes)
+        const WeakNodeList &weak_nodes,
+        DispatchInfo *info = nullptr)
     {
-        timespec current_time_test;
         const PriorityExecutable *next_exec = nullptr;
+        size_t next_id;
         
-        //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time_test);
-        //uint64_t millis1 = (current_time_test.tv_sec * (uint64_t)1000) + (current_time_test.tv_nsec / 1000000);
         //print_all_executables_();
-        //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time_test);
-        //uint64_t millis2 = (current_time_test.tv_sec * (uint64_t)1000) + (current_time_test.tv_nsec / 1000000);
-        //std::cout << "print_spend_time: " << millis2 - millis1 << std::endl;
         while (!all_executables_.empty())
         {   
-            next_exec = all_executables_.top();
+            // only ready executables are in the heap
+            next_id = all_executables_.top();
+            next_exec = &executables_[next_id];
             //std::cout << "next_exec_chain_id: " << next_exec->chain_id << " deadlines: " << next_exec->deadlines->front() << std::endl;
             //std::cout << "all_executables.size(): " << all_executables_.size() << std::endl;
             all_executables_.pop();
-            /*
-            if(next_exec->can_be_run) {
-                std::cout << "_schedule_type: " << next_exec->sched_type;
-                std::cout << " chain_id: " << next_exec->chain_id;
-                std::cout << " is_first_in_chain: " << next_exec->is_first_in_chain;
-                //std::cout << " deadlines: " << (next_exec->deadlines == nullptr ? -1 : next_exec->deadlines->front())<< std::endl;
-                if(next_exec->deadlines == nullptr) {
-                    std::cout << " deadlines nullptr" << std::endl;
-                } else {
-                    std::cout << " deadlines: " << next_exec->deadlines->front() << std::endl;
-                }
-                std::cout << " type: " << next_exec->type;
-                clock_gettime(CLOCK_MONOTONIC_RAW, &current_time_test);
-                uint64_t millis1 = (current_time_test.tv_sec * (uint64_t)1000) + (current_time_test.tv_nsec / 1000000);
-                std::cout << " current_time: " << millis1 << std::endl;
-                if(next_exec->type == SUBSCRIPTION) {
-                    std::shared_ptr<const rcl_subscription_t> subs_handle = std::static_pointer_cast<const rcl_subscription_t>(next_exec->handle);
-                    auto subscription = get_subscription_by_handle(subs_handle, weak_nodes);
-                    std::cout << " sub: " << subscription;
-                    auto group = get_group_by_subscription(subscription, weak_nodes);
-                    std::cout << " group: " << group; 
-                    std::cout << " can_be_taken_from: " << group->can_be_taken_from().load() << std::endl;
-                    //std::cout << "all_executables.size(): " << all_executables_.size() << std::endl;
-                }
-                //std::cout << " group: " << get_group_by_subscription(subscription, weak_nodes) << std::endl;
-            } 
-            */
             
-            if (!next_exec->can_be_run)
-            {
-                //std::cout << "!next_exec->can_be_run" << std::endl;
-                continue;
-            }
             ExecutableType type = next_exec->type;
+            rclcpp::CallbackGroup::SharedPtr group;
+            rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base;
             switch (type)
             {
             case SUBSCRIPTION:
             {
-                std::shared_ptr<const rcl_subscription_t> subs_handle = std::static_pointer_cast<const rcl_subscription_t>(next_exec->handle);
-                auto subscription = get_subscription_by_handle(subs_handle, weak_nodes);
+                auto subscription = resolve<rclcpp::SubscriptionBase>(
+                    next_id, weak_nodes, group, node_base,
+                    [&]()
+                    { return get_subscription_by_handle(std::static_pointer_cast<const rcl_subscription_t>(next_exec->handle), weak_nodes); },
+                    [&](const std::shared_ptr<rclcpp::SubscriptionBase> &entity)
+                    { return get_group_by_subscription(entity, weak_nodes); });
                 if (subscription)
                 {
-                    auto group = get_group_by_subscription(subscription, weak_nodes);
                     if (!group)
                     {
                         // Group was not found, meaning the waitable is not valid...
                         // Remove it from the ready list and continue looking
-                        //it = subscription_handles_.erase(it);
                         continue;
                     }
                     if (!group->can_be_taken_from().load())
                     {
                         // Group is mutually exclusive and is being used, so skip it for now
                         // Leave it to be checked next time, but continue searching
-                        //++it;
+                        skipped_ids_.push_back(next_id);
                         continue;
                     }
                     any_exec.callback_group = group;
                     any_exec.subscription = subscription;
-                    any_exec.node_base = get_node_by_group(group, weak_nodes);
+                    any_exec.node_base = node_base;
                     // std::cout << "Using new priority sub " << subscription->get_topic_name() << std::endl;
                 }
             }
             break;
             case SERVICE:
             {
-                std::shared_ptr<const rcl_service_t> service_handle = std::static_pointer_cast<const rcl_service_t>(next_exec->handle);
-                auto service = get_service_by_handle(service_handle, weak_nodes);
+                auto service = resolve<rclcpp::ServiceBase>(
+                    next_id, weak_nodes, group, node_base,
+                    [&]()
+                    { return get_service_by_handle(std::static_pointer_cast<const rcl_service_t>(next_exec->handle), weak_nodes); },
+                    [&](const std::shared_ptr<rclcpp::ServiceBase> &entity)
+                    { return get_group_by_service(entity, weak_nodes); });
                 if (service)
                 {
-                    auto group = get_group_by_service(service, weak_nodes);
                     if (!group)
                     {
                         // Group was not found, meaning the waitable is not valid...
                         // Remove it from the ready list and continue looking
-                        // it = subscription_handles_.erase(it);
                         continue;
                     }
                     if (!group->can_be_taken_from().load())
                     {
                         // Group is mutually exclusive and is being used, so skip it for now
                         // Leave it to be checked next time, but continue searching
-                        // ++it;
+                        skipped_ids_.push_back(next_id);
                         continue;
                     }
                     any_exec.callback_group = group;
                     any_exec.service = service;
-                    any_exec.node_base = get_node_by_group(group, weak_nodes);
+                    any_exec.node_base = node_base;
                     // std::cout << "Using new priority service " << service->get_service_name() << std::endl;
                 }
             }
             break;
             case CLIENT:
             {
-                std::shared_ptr<const rcl_client_t> client_handle = std::static_pointer_cast<const rcl_client_t>(next_exec->handle);
-                auto client = get_client_by_handle(client_handle, weak_nodes);
+                auto client = resolve<rclcpp::ClientBase>(
+                    next_id, weak_nodes, group, node_base,
+                    [&]()
+                    { return get_client_by_handle(std::static_pointer_cast<const rcl_client_t>(next_exec->handle), weak_nodes); },
+                    [&](const std::shared_ptr<rclcpp::ClientBase> &entity)
+                    { return get_group_by_client(entity, weak_nodes); });
                 if (client)
                 {
-                    auto group = get_group_by_client(client, weak_nodes);
                     if (!group)
                     {
                         // Group was not found, meaning the waitable is not valid...
                         // Remove it from the ready list and continue looking
-                        // it = subscription_handles_.erase(it);
                         continue;
                     }
                     if (!group->can_be_taken_from().load())
                     {
                         // Group is mutually exclusive and is being used, so skip it for now
                         // Leave it to be checked next time, but continue searching
-                        // ++it;
+                        skipped_ids_.push_back(next_id);
                         continue;
                     }
                     any_exec.callback_group = group;
                     any_exec.client = client;
-                    any_exec.node_base = get_node_by_group(group, weak_nodes);
+                    any_exec.node_base = node_base;
                     // std::cout << "Using new priority client " << client->get_service_name() << std::endl;
                 }
             }
             break;
             case TIMER:
             {
-                std::shared_ptr<const rcl_timer_t> timer_handle = std::static_pointer_cast<const rcl_timer_t>(next_exec->handle);
-                auto timer = get_timer_by_handle(timer_handle, weak_nodes);
+                auto timer = resolve<rclcpp::TimerBase>(
+                    next_id, weak_nodes, group, node_base,
+                    [&]()
+                    { return get_timer_by_handle(std::static_pointer_cast<const rcl_timer_t>(next_exec->handle), weak_nodes); },
+                    [&](const std::shared_ptr<rclcpp::TimerBase> &entity)
+                    { return get_group_by_timer(entity, weak_nodes); });
                 if (timer)
                 {
-                    auto group = get_group_by_timer(timer, weak_nodes);
                     if (!group)
                     {
                         // Group was not found, meaning the waitable is not valid...
                         // Remove it from the ready list and continue looking
-                        //it = subscription_handles_.erase(it);
                         continue;
                     }
                     if (!group->can_be_taken_from().load())
                     {
                         // Group is mutually exclusive and is being used, so skip it for now
                         // Leave it to be checked next time, but continue searching
-                        //++it;
+                        skipped_ids_.push_back(next_id);
                         continue;
                     }
                     any_exec.callback_group = group;
                     any_exec.timer = timer;
-                    any_exec.node_base = get_node_by_group(group, weak_nodes);
+                    any_exec.node_base = node_base;
                 }
             }
             break;
             case WAITABLE:
             {
-                std::shared_ptr<rclcpp::Waitable> waitable_handle = std::static_pointer_cast<rclcpp::Waitable>(next_exec->waitable);
-                auto waitable = waitable_handle;
+                auto waitable = resolve<rclcpp::Waitable>(
+                    next_id, weak_nodes, group, node_base,
+                    [&]()
+                    { return next_exec->waitable; },
+                    [&](const std::shared_ptr<rclcpp::Waitable> &entity)
+                    { return get_group_by_waitable(entity, weak_nodes); });
                 if (waitable)
                 {
-                    auto group = get_group_by_waitable(waitable, weak_nodes);
                     if (!group)
                     {
                         // Group was not found, meaning the waitable is not valid...
                         // Remove it from the ready list and continue looking
-                        // it = subscription_handles_.erase(it);
                         continue;
                     }
                     if (!group->can_be_taken_from().load())
                     {
                         // Group is mutually exclusive and is being used, so skip it for now
                         // Leave it to be checked next time, but continue searching
-                        // ++it;
+                        skipped_ids_.push_back(next_id);
                         continue;
                     }
                     any_exec.callback_group = group;
                     any_exec.waitable = waitable;
-                    any_exec.node_base = get_node_by_group(group, weak_nodes);
+                    any_exec.node_base = node_base;
                     // std::cout << "Using new priority waitable" << std::endl;
                 }
             }
@@ -765,218 +1091,117 @@ public:
                 // std::cout << "Unknown type from priority!!!" << std::endl;
                 break;
             }
-            // callback is about to be released
-            *(next_exec->sum) += 1;
-            if (next_exec->is_first_in_chain && next_exec->sched_type != DEADLINE)
-            {
-                //timespec current_time;
-                //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                //uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-
-                //auto timer = next_exec->timer_handle;
-                //int64_t time_until_next_call = timer->time_until_trigger().count() / 1000000;
-                //std::cout << "end of chain. time until trigger: " << std::to_string(time_until_next_call) << std::endl;
-                // log_entry(logger, "timer_" + std::to_string(next_exec->chain_id) + "_release_" + std::to_string(millis + time_until_next_call));
-                if (next_exec->chain_id == 0 && is_f1tenth)
-                {
-                    // special case for logging the shared timer
-                    //log_entry(logger, "timer_" + std::to_string(next_exec->chain_id + 1) + "_release_" + std::to_string(millis + time_until_next_call));
-                }
-            }
-            //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time_test);
-            //uint64_t millis2 = (current_time_test.tv_sec * (uint64_t)1000) + (current_time_test.tv_nsec / 1000000);
-            //std::cout << "current_time_test: " << millis2 - millis1 << " current_time: " << millis2 << std::endl;
-            //std::cout << "is_first_in_chain: " << next_exec->is_first_in_chain << " sched_type: " << next_exec->sched_type << std::endl;
-            if (next_exec->is_first_in_chain && next_exec->sched_type == DEADLINE)
+            // before dispatching re-keys the chain, which only reaches executables in the heap
+            restore_skipped();
+            on_dispatch(next_exec, info);
+            return;
+        }
+        restore_skipped();
+    }
+
+    /// Put back the ready executables get_next_executable() passed over for a busy group.
+    void restore_skipped()
+    {
+        for (size_t id : skipped_ids_)
+        {
+            all_executables_.push(id);
+        }
+        skipped_ids_.clear();
+    }
+
+    /// Chain bookkeeping for an executable that is about to run.
+    void on_dispatch(const PriorityExecutable *next_exec, DispatchInfo *info = nullptr)
+    {
+        size_t id = next_exec->id;
+        // a fused successor may also have been marked ready
+        all_executables_.remove(id);
+        if (next_exec->fusion_missed)
+        {
+            // the missed message is being handled, the predecessor runs this again
+            executables_[id].fusion_missed = false;
+            handles_dirty_ = true;
+        }
+        if (info != nullptr)
+        {
+            // the chain bookkeeping below moves the stage on to the next instance
+            const Job *job = get_current_job(next_exec);
+            info->deadline = job != nullptr ? job->deadline : 0;
+            info->instance = job != nullptr ? job->instance : NO_JOB_INSTANCE;
+            info->release_time = job != nullptr ? job->release_time : 0;
+            info->chain_id = state_.chain_id[id];
+            info->id = id;
+            info->sort_key = state_.sort_key[id];
+            info->last_in_chain = next_exec->is_last_in_chain;
+            info->has_chain_successor = next_exec->chain_successor != NO_EXECUTABLE_ID;
+        }
+        // callback is about to be released
+        state_.releases[id] += 1;
+        if (next_exec->sched_type == DEADLINE && !next_exec->join_inputs.empty())
+        {
+            PriorityExecutable *join = &executables_[id];
+            // a join consumes one released instance of every input
+            for (size_t i = 0; i < join->join_inputs.size(); ++i)
             {
-                if (next_exec->timer_handle == nullptr)
+                ChainJobs *jobs = join->join_inputs[i];
+                uint64_t instance = std::max(join->join_instances[i], jobs->oldest_instance());
+                Job *job = jobs->find(instance);
+                if (job == nullptr)
                 {
-                    std::cout << "tried to use a chain without a timer handle!!!" << std::endl;
-                }
-                timespec current_time;
-                clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-                //std::cout << "current_time: " << millis << " chain_id: " << next_exec->chain_id << std::endl;
-                auto timer = next_exec->timer_handle;
-                //std::cout << "timer->time_until_trigger().count(): " << timer->time_until_trigger().count() / 1000000 << std::endl;
-                //std::cout << "in executor get release time: " << millis + timer->time_until_trigger().count() / 1000000 << std::endl;
-                //std::cout << "record release time: " << *next_exec->release_time << " chain_index: " << next_exec->chain_id << std::endl;
-                //log_entry(logger, std::to_string(next_exec->chain_id) + " release_time: " + std::to_string(*next_exec->release_time));    
-                int64_t time_diff = millis - *next_exec->release_time;
-                if (time_diff < 0) time_diff = -time_diff;
-                int max_chain_num = std::ceil(next_exec->deadline / (double)next_exec->period);
-                int index = ((*next_exec->cur_index) + 1) % max_chain_num;
-                //std::cout << "max_chain_num: " << max_chain_num << " cur_index: " << (*next_exec->cur_index) << " index: " << index << std::endl;
-                if (time_diff < next_exec->period) {
-                    //std::cout << "before add: " << *next_exec->release_time << std::endl; 
-                    *next_exec->release_time = *next_exec->release_time + next_exec->period;
-                    //std::cout << "after add: " << *next_exec->release_time << " " << next_exec->period << std::endl;
-                    (*next_exec->deadlines)[index]->push_back(*next_exec->release_time + next_exec->deadline);
-                    //next_exec->deadlines->push_back(*next_exec->release_time + next_exec->deadline);
-                    if (is_f1tenth && next_exec->chain_id == 0) {
-                        for (auto it : priority_map) {
-                            if(it.second.chain_id == 1) {
-                                (*it.second.deadlines)[index]->push_back(*next_exec->release_time + next_exec->deadline);
-                                //it.second.deadlines->push_back(*next_exec->release_time + next_exec->deadline);
-                                break;
-                            }
-                        }
-                    }
-                } else {
-                    //std::cout << "before add: " << *next_exec->release_time << std::endl; 
-                    int periods_late = std::ceil(time_diff / (double)next_exec->period);
-                    //std::cout << "periods_late: " << periods_late << " millis: " << millis << " release_time: " << *next_exec->release_time << std::endl; 
-                    *next_exec->release_time = *next_exec->release_time + (periods_late) * next_exec->period;
-                    //std::cout << "after add: " << *next_exec->release_time << " " << next_exec->period << " " << periods_late << std::endl;
-                    (*next_exec->deadlines)[index]->push_back(*next_exec->release_time + next_exec->deadline);
-                    //next_exec->deadlines->push_back(*next_exec->release_time + next_exec->deadline);
-                    if (is_f1tenth && next_exec->chain_id == 0) {
-                        for (auto it : priority_map) {
-                            if(it.second.chain_id == 1) {
-                                (*it.second.deadlines)[index]->push_back(*next_exec->release_time + next_exec->deadline);
-                                //it.second.deadlines->push_back(*next_exec->release_time + next_exec->deadline);
-                                break;
-                            }
-                        }
-                    }
-                }
-                /*
-                if(next_exec->chain_id == 0 && is_f1tenth) {
-                    //std::cout << "next_exec->deadlines: " << next_exec->deadlines->front() << std::endl;
-                    next_exec->deadlines->pop_front();
+                    continue;
                 }
-                */
-                /*
-                timespec current_time;
-                clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-                auto timer = next_exec->timer_handle;
-                if (timer == nullptr)
+                job->stage += 1;
+                if (join->is_last_in_chain)
                 {
-                    std::cout << "somehow, this timer handle didn't have an associated timer" << std::endl;
-                }
-                int64_t time_until_next_call = timer->time_until_trigger().count() / 1000000;
-                std::cout << "time until trigger: " << std::to_string(time_until_next_call) << std::endl;
-                std::cout << "timer->time_until_trigger().count(): " <<  timer->time_until_trigger().count() << std::endl;
-                log_entry(logger," timer_" + std::to_string(next_exec->chain_id) + "_release_" + std::to_string(millis + time_until_next_call));
-                uint64_t next_deadline = millis + time_until_next_call + next_exec->period;
-                next_exec->deadlines->push_back(next_deadline);
-                if(next_exec->chain_id == 0 && is_f1tenth) {
-                    for(auto it : priority_map) {
-                        if(it.second.chain_id == 1) {
-                            it.second.deadlines->push_back(next_deadline);
-                            break;
-                        }
-                    }
+                    jobs->complete(instance);
                 }
-                log_entry(logger, "deadline_" + std::to_string(next_exec->chain_id) + "_" + std::to_string(next_deadline));
-                // std::cout << "deadline set" << std::endl;
-                */
+                join->join_instances[i] = instance + 1;
+                refresh_ready_deadlines(jobs);
             }
-            if (next_exec->is_last_in_chain && next_exec->sched_type == DEADLINE)
+        }
+        else if (next_exec->sched_type == DEADLINE && next_exec->jobs != nullptr)
+        {
+            ChainJobs *jobs = next_exec->jobs;
+            uint64_t instance = get_current_instance(next_exec);
+            Job *job = jobs->find(instance);
+            if (job != nullptr)
             {
-                /*
-                if(next_exec->chain_id == 0 || next_exec->chain_id == 1) {
-                    for(auto it : priority_map) {
-                        if(it.second.chain_id == 0 && it.second.is_first_in_chain) {
-                            std::cout << "size: " << it.second.deadlines->size() << std::endl;
-                        }
-                    }
-                }
-                */
-               /*
-                timespec current_time;
-                clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                uint64_t millis = (current_time.tv_sec * 1000UL) + (current_time.tv_nsec / 1000000);
-
-                uint64_t this_deadline = next_exec->deadlines->front();
-                
-                std::ostringstream oss;
-                if (next_exec->timer_handle == nullptr)
-                {
-                    std::cout << "tried to use a chain without a timer handle!!!" << std::endl;
-                }
-                auto timer = next_exec->timer_handle;
-                std::cout << "chain_id: " << next_exec->chain_id <<" last_chain_until_next_timer: " << millis + timer->time_until_trigger().count() / 1000000 << std::endl;
-                std::cout << "this_deadline: " << this_deadline << std::endl;
-                if (timer == nullptr)
-                {
-                    std::cout << "somehow, this timer handle didn't have an associated timer" << std::endl;
-                }
-                uint64_t next_deadline = 0;
-                bool on_time;
-                int64_t time_diff = millis - this_deadline;
-                //std::cout << " id: " << next_exec->chain_id <<" millis: " << millis << " this_deadline: " << this_deadline << std::endl;
-                int periods_late;
-                if (time_diff < 0)
-                {
-                    periods_late = 0;
-                    next_deadline = this_deadline + next_exec->period;
-                    //std::cout << "id: " << next_exec->chain_id << " this_deadline: " << this_deadline << " period: " << next_exec->period << std::endl;
-                    on_time = true;
-                }
-                // if time_diff is positive, we completed late. add one period for each period we were late
-                else
+                job->stage += 1;
+            }
+            if (next_exec->is_first_in_chain)
+            {
+                // the timer fired for this instance, release the next one a period
+                // after it, or after the last period boundary if we fell behind
+                uint64_t now = simple_timer::now_ns();
+                uint64_t release_time = jobs->last_release_time();
+                uint64_t period = jobs->period > 0 ? (uint64_t)jobs->period : 0;
+                uint64_t periods = 1;
+                if (period > 0 && now > release_time)
                 {
-                    periods_late = std::ceil(time_diff / (double)next_exec->period);
-                    next_deadline = this_deadline + (periods_late + 1) * next_exec->period;
-                    on_time = false;
-                    //std::cout << "on_time_false, chain_id: " << next_exec->chain_id << " time_diff: " << time_diff << std::endl;
-                    //std::cout << "deadlines size: " << next_exec->deadlines->size() << std::endl;
+                    periods = (now - release_time + period - 1) / period;
                 }
-                 oss << "{\"operation\": \"next_deadline\", \"chain_id\": " << next_exec->chain_id << ", \"deadline\": " << next_deadline << ", \"on_time\": " << on_time << ", \"time_diff\": " << time_diff << ", \"periods_late\": " << periods_late;
-                log_entry(logger, oss.str());
-                next_exec->deadlines->push_back(next_deadline);
-                */
-                
-               
-                /*if(is_f1tenth && (next_exec->chain_id == 0 || next_exec->chain_id == 1)) {
-                    for(auto it : priority_map) {
-                        if(it.second.chain_id == 0 && it.second.is_first_in_chain) {
-                            if(it.second.deadlines->front() > next_deadline || it.second.deadlines->empty()) {
-                                if(!it.second.deadlines->empty()) {
-                                   // std::cout << "front data: " << it.second.deadlines->front() << " deadlines size: " << it.second.deadlines->size() << std::endl;
-                                    it.second.deadlines->pop_front();
-                                }
-                                //std::cout << "next_deadline: " << next_deadline << std::endl;
-                                it.second.deadlines->push_back(next_deadline);
-                                //std::cout << "deadlines size: " << it.second.deadlines->size() << std::endl;
-                            }
-                            break;
-                        }
-                    }
-                }*/
-                int max_chain_num = std::ceil(next_exec->deadline / (double)next_exec->period);
-                //int index = ((*next_exec->cur_index) + 1) % max_chain_num;
-                if (!(*next_exec->deadlines)[(*next_exec->cur_index)]->empty())
-                    (*next_exec->deadlines)[(*next_exec->cur_index)]->pop_front();
-                    //next_exec->deadlines->pop_front();
+                release_jobs(jobs, release_time + periods * period);
             }
-            if (next_exec->sched_type == DEADLINE) {
-                int max_chain_num = std::ceil(next_exec->deadline / (double)next_exec->period);
-                (*next_exec->cur_index) = ((*next_exec->cur_index) + 1) % max_chain_num;        
-            }
-            if (next_exec->sched_type == CHAIN_AWARE_PRIORITY || next_exec->sched_type == DEADLINE)
+            if (next_exec->is_last_in_chain)
             {
-                // this is safe, since we popped it earlier
-                // get a mutable reference
-                // TODO: find a cleaner way to do this
-                PriorityExecutable *mut_executable = get_priority_settings(next_exec->handle);
-                // std::cout << "running chain aware cb" << std::endl;
-                mut_executable->increment_counter();
+                jobs->complete(instance);
             }
-            if (next_exec->sched_type == CHAIN_AWARE_PRIORITY && next_exec->is_first_in_chain) {
-                //std::cout << "chain_id: " << next_exec->chain_id << std::endl;
-                //timespec current_time;
-                //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-                //uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-                //auto timer = next_exec->timer_handle;
-                //int64_t time_until_next_call = timer->time_until_trigger().count() / 1000000;
-                //int64_t release_time = millis + time_until_next_call;
-                //log_entry(logger, std::to_string(next_exec->chain_id) + " release_time: " + std::to_string(release_time)); 
+            state_.instance[id] = instance + 1;
+            if (!next_exec->is_first_in_chain)
+            {
+                // releasing refreshed the chain already
+                refresh_ready_deadlines(jobs);
             }
-            return;
         }
+        if (next_exec->sched_type == CHAIN_AWARE_PRIORITY || next_exec->sched_type == DEADLINE)
+        {
+            // std::cout << "running chain aware cb" << std::endl;
+            state_.counter[id] += 1;
+        }
+    }
+
+    size_t number_of_ready_executables() const
+    {
+        return all_executables_.size();
     }
 
     void
@@ -1172,6 +1397,12 @@ public:
 
     rcl_allocator_t get_allocator() override
     {
+        // rcl reallocates its wait set arrays, which the generic rclcpp adapter
+        // does not preserve, and sizes them once; the resource only backs the strategy
+        if (std::is_same<VoidAlloc, timed_executor::ResourceAllocator<void *>>::value)
+        {
+            return rcl_get_default_allocator();
+        }
         return rclcpp::allocator::get_rcl_allocator<void *, VoidAlloc>(*allocator_.get());
     }
 
@@ -1244,49 +1475,86 @@ public:
     void set_executable_priority(std::shared_ptr<const void> handle, int priority, ExecutableType t)
     {
         // TODO: any sanity checks should go here
-        // priority_map.insert(executable, priority);
-        priority_map[handle] = PriorityExecutable(handle, priority, t);
+        register_executable(handle, PriorityExecutable(handle, priority, t));
+        invalidate_entity_cache();
     }
     void set_executable_priority(std::shared_ptr<const void> handle, int priority, ExecutableType t, ExecutableScheduleType sc, int chain_index)
     {
         // TODO: any sanity checks should go here
-        // priority_map.insert(executable, priority);
-        priority_map[handle] = PriorityExecutable(handle, priority, t, sc);
-        priority_map[handle].chain_id = chain_index;
+        PriorityExecutable exec(handle, priority, t, sc);
+        exec.chain_id = chain_index;
+        register_executable(handle, exec);
+        invalidate_entity_cache();
     }
 
-    void set_executable_deadline(std::shared_ptr<const void> handle, int period, int deadline, ExecutableType t, int chain_id = 0)
+    void set_executable_deadline(std::shared_ptr<const void> handle, std::chrono::nanoseconds period, std::chrono::nanoseconds deadline, ExecutableType t, int chain_id = 0)
     {
         // TODO: any sanity checks should go here
-        // priority_map.insert(executable, priority);
-        priority_map[handle] = PriorityExecutable(handle, period, deadline, t, DEADLINE);
-        priority_map[handle].chain_id = chain_id;
+        PriorityExecutable exec(handle, period, deadline, t);
+        exec.chain_id = chain_id;
+        exec.jobs = add_chain_jobs(chain_id, period.count(), deadline.count());
+        register_executable(handle, exec);
+        invalidate_entity_cache();
     }
 
-    int get_priority(std::shared_ptr<const void> executable)
+    /// Period and relative deadline in milliseconds.
+    void set_executable_deadline(std::shared_ptr<const void> handle, int period, int deadline, ExecutableType t, int chain_id = 0)
+    {
+        set_executable_deadline(handle, std::chrono::milliseconds(period), std::chrono::milliseconds(deadline), t, chain_id);
+    }
+
+    /// Worst case runtime estimate of an executable, used to size CPU reservations.
+    void set_executable_runtime(std::shared_ptr<const void> handle, std::chrono::nanoseconds runtime)
     {
-        auto search = priority_map.find(executable);
-        if (search != priority_map.end())
+        PriorityExecutable *exec = get_priority_settings(handle);
+        if (exec == nullptr)
         {
-            return search->second.priority;
+            throw std::runtime_error("set_executable_runtime: executable has no settings");
         }
-        else
+        exec->runtime = runtime.count();
+    }
+
+    /// Demand of the chains registered with set_executable_deadline(), by chain id.
+    std::map<int, ChainDemand> get_chain_demands()
+    {
+        std::map<int, ChainDemand> demands;
+        for (const PriorityExecutable &exec : executables_)
         {
-            return 0;
+            if (exec.sched_type != DEADLINE)
+            {
+                continue;
+            }
+            ChainDemand &demand = demands[exec.chain_id];
+            demand.runtime += exec.runtime;
+            if (demand.period == 0 || exec.period < demand.period)
+            {
+                demand.period = exec.period;
+            }
         }
+        return demands;
+    }
+
+    int get_priority(std::shared_ptr<const void> executable)
+    {
+        PriorityExecutable *exec = get_priority_settings(executable);
+        return exec != nullptr ? exec->priority : 0;
+    }
+
+    /// Dense id of a registered executable, NO_EXECUTABLE_ID if it has none.
+    size_t get_executable_id(std::shared_ptr<const void> executable) const
+    {
+        auto search = executable_ids_.find(executable);
+        return search != executable_ids_.end() ? search->second : NO_EXECUTABLE_ID;
+    }
+
+    PriorityExecutable *get_executable(size_t id)
+    {
+        return id < executables_.size() ? &executables_[id] : nullptr;
     }
 
     PriorityExecutable *get_priority_settings(std::shared_ptr<const void> executable)
     {
-        auto search = priority_map.find(executable);
-        if (search != priority_map.end())
-        {
-            return &(search->second);
-        }
-        else
-        {
-            return nullptr;
-        }
+        return get_executable(get_executable_id(executable));
     }
 
     void set_first_in_chain(std::shared_ptr<const void> exec_handle)
@@ -1301,54 +1569,210 @@ public:
         settings->is_last_in_chain = true;
     }
 
-    void assign_deadlines_queue(std::shared_ptr<const void> exec_handle, std::vector<std::deque<uint> *> *deadlines)
+    /// The jobs of a chain registered with set_executable_deadline(), nullptr for unknown chains.
+    ChainJobs *get_chain_jobs(int chain_id)
     {
-        PriorityExecutable *settings = get_priority_settings(exec_handle);
-        settings->deadlines = deadlines;
+        auto search = chain_jobs_.find(chain_id);
+        return search != chain_jobs_.end() ? &search->second : nullptr;
     }
 
-    void assign_release_time(std::shared_ptr<const void> exec_handle, int release_time) {
-        PriorityExecutable *settings = get_priority_settings(exec_handle);
-        settings->release_time = new long(release_time);
+    /// Release the first instance of a chain at release_time, see simple_timer::now_ns().
+    /**
+     * Its first stage releases the following instances, one period apart.
+     * Returns false if the chain has too many outstanding instances.
+     */
+    bool release_chain_job(int chain_id, std::chrono::nanoseconds release_time)
+    {
+        ChainJobs *jobs = get_chain_jobs(chain_id);
+        if (jobs == nullptr)
+        {
+            throw std::runtime_error("release_chain_job: chain has no deadline executables");
+        }
+        return release_jobs(jobs, release_time.count());
+    }
+
+    /// Fan a chain out: every release of source_chain_id also releases branch_chain_id.
+    /**
+     * The branch keeps its own relative deadline and starts no instances of its
+     * own; releasing the source with release_chain_job() releases the branch too.
+     */
+    void fork_chain(int source_chain_id, int branch_chain_id)
+    {
+        ChainJobs *source = get_chain_jobs(source_chain_id);
+        ChainJobs *branch = get_chain_jobs(branch_chain_id);
+        if (source == nullptr || branch == nullptr)
+        {
+            throw std::runtime_error("fork_chain: both chains need deadline executables");
+        }
+        if (reaches(branch, source))
+        {
+            throw std::runtime_error("fork_chain: chains must not form a cycle");
+        }
+        source->branches.push_back(branch);
+    }
+
+    /// Make a deadline executable join chains, e.g. a callback fed by several pipelines.
+    /**
+     * It runs with the earliest outstanding deadline among its inputs, and every
+     * run consumes one released instance of each; as the last stage it completes them.
+     */
+    void set_join_inputs(std::shared_ptr<const void> handle, const std::vector<int> &chain_ids)
+    {
+        PriorityExecutable *exec = get_priority_settings(handle);
+        if (exec == nullptr || exec->sched_type != DEADLINE)
+        {
+            throw std::runtime_error("set_join_inputs: executable needs a deadline");
+        }
+        timed_executor::MemoryResource *resource = timed_executor::memory_resource_of(*allocator_);
+        unlink_chain_jobs(exec);
+        exec->join_inputs = decltype(exec->join_inputs)(resource);
+        for (int chain_id : chain_ids)
+        {
+            ChainJobs *jobs = get_chain_jobs(chain_id);
+            if (jobs == nullptr)
+            {
+                throw std::runtime_error("set_join_inputs: chain has no deadline executables");
+            }
+            exec->join_inputs.push_back(jobs);
+        }
+        exec->join_instances = decltype(exec->join_instances)(exec->join_inputs.size(), 0, resource);
+        link_chain_jobs(exec);
+        if (all_executables_.contains(exec->id))
+        {
+            state_.sort_key[exec->id] = get_sort_key(exec);
+            all_executables_.update(exec->id);
+        }
+    }
+
+    /// Outstanding instances each chain can hold, for chains registered afterwards.
+    void set_chain_job_capacity(size_t capacity)
+    {
+        chain_job_capacity_ = capacity;
+    }
+
+    /// Record execution times, release latencies and chain response times from now on.
+    /**
+     * Recording is lock-free, so workers record straight into the shared
+     * histograms of get_latencies() and get_chain_jobs() as they finish.
+     */
+    void set_record_latencies(bool record)
+    {
+        record_latencies_ = record;
+    }
+
+    /// Latencies of a registered executable, nullptr if it has none.
+    const ExecutableLatencies *get_latencies(std::shared_ptr<const void> handle) const
+    {
+        size_t id = get_executable_id(handle);
+        return id < latencies_.size() ? &latencies_[id] : nullptr;
+    }
+
+    /// Called by the executor as the executable handed out with info starts running.
+    void dispatch_started(DispatchInfo &info)
+    {
+        if (record_latencies_)
+        {
+            info.start_time = simple_timer::now_ns();
+        }
+        log_entry(logger, TRACE_DISPATCH_START, info.chain_id, info.instance, info.deadline);
+    }
+
+    /// Called as it returned; traces a deadline miss if it finished its chain instance late.
+    void dispatch_finished(const DispatchInfo &info)
+    {
+        log_entry(logger, TRACE_DISPATCH_END, info.chain_id, info.instance, info.deadline);
+        bool check_miss = logger.enabled && info.last_in_chain && info.deadline != 0;
+        if (!check_miss && !(record_latencies_ && info.start_time != 0))
+        {
+            return;
+        }
+        uint64_t now = simple_timer::now_ns();
+        if (record_latencies_ && info.start_time != 0 && info.id < latencies_.size())
+        {
+            ExecutableLatencies &latencies = latencies_[info.id];
+            latencies.execution_time.record(now - info.start_time);
+            // a timer stage starts its instance slightly before the release time it was given
+            if (info.release_time != 0 && info.start_time >= info.release_time)
+            {
+                latencies.release_latency.record(info.start_time - info.release_time);
+                ChainJobs *jobs = info.last_in_chain ? get_chain_jobs(info.chain_id) : nullptr;
+                if (jobs != nullptr)
+                {
+                    jobs->response_time.record(now - info.release_time);
+                }
+            }
+        }
+        if (check_miss && now > info.deadline)
+        {
+            log_entry(logger, TRACE_DEADLINE_MISS, info.chain_id, info.instance, info.deadline);
+        }
+    }
+
+    /// Print p50, p99, p99.9 and max in microseconds of everything recorded so far, and the releases every chain dropped.
+    void print_latencies()
+    {
+        auto print = [](const simple_timer::LatencyHistogram &histogram) {
+            std::cout << " n: " << histogram.count()
+                      << " p50: " << histogram.percentile(50) / 1000
+                      << " p99: " << histogram.percentile(99) / 1000
+                      << " p99.9: " << histogram.percentile(99.9) / 1000
+                      << " max: " << histogram.max() / 1000;
+        };
+        for (const PriorityExecutable &exec : executables_)
+        {
+            const ExecutableLatencies &latencies = latencies_[exec.id];
+            std::cout << "chain_id: " << exec.chain_id << " id: " << exec.id << " execution_time:";
+            print(latencies.execution_time);
+            std::cout << std::endl;
+            if (latencies.release_latency.count() != 0)
+            {
+                std::cout << "chain_id: " << exec.chain_id << " id: " << exec.id << " release_latency:";
+                print(latencies.release_latency);
+                std::cout << std::endl;
+            }
+        }
+        for (const auto &chain : chain_jobs_)
+        {
+            std::cout << "chain_id: " << chain.first << " response_time:";
+            print(chain.second.response_time);
+            std::cout << " overflows: " << chain.second.overflows() << std::endl;
+        }
     }
 
     void print_all_handle_schedule_type() {
-        for(auto it : priority_map) {
-            std::cout << "chain_id: " << it.second.chain_id;
-            std::cout << " _schedule_type: " << it.second.sched_type;
-            std::cout << " _type: " << it.second.type;
-            //std::cout << " _deadline: " << (it.second.deadlines == nullptr ? -1 : it.second.deadlines->front())<< std::endl;
-            if(it.second.deadlines->empty()) std::cout << " _deadlines: "<< "nullptr";
-            else std::cout << " _deadlines: " << it.second.deadlines->front();
-            std::cout << " count_chain: " << *(it.second.sum);
-            std::cout << " is_first_in_chain: " << (it.second.is_first_in_chain ? "yes" : "no") << std::endl;
+        for(auto &exec : executables_) {
+            std::cout << "chain_id: " << exec.chain_id;
+            std::cout << " _schedule_type: " << exec.sched_type;
+            std::cout << " _type: " << exec.type;
+            //std::cout << " _deadline: " << (exec->deadlines == nullptr ? -1 : exec->deadlines->front())<< std::endl;
+            if(get_current_deadline(&exec) == 0) std::cout << " _deadlines: "<< "nullptr";
+            else std::cout << " _deadlines: " << get_current_deadline(&exec);
+            std::cout << " count_chain: " << state_.releases[exec.id];
+            std::cout << " is_first_in_chain: " << (exec.is_first_in_chain ? "yes" : "no") << std::endl;
         }
     }
     void print_all_executables_() {
-        timespec current_time;
-        clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-        uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+        uint64_t millis = simple_timer::now_ns() / 1000000;
         std::cout << "print_all_can_be_run_executables thread_id: " << pthread_self() << " current_time: " << millis << std::endl;
         //std::cout << " current_time: " << millis << std::endl;
         //std::cout << "size: " << all_executables_.size() << std::endl;
-        std::priority_queue<const PriorityExecutable *, std::vector<const PriorityExecutable *>, PriorityExecutableComparator> temp;
-        temp = all_executables_;
+        ReadyHeap temp = all_executables_;
 
         const PriorityExecutable *next_exec = nullptr;
         while(!temp.empty()) {
-            next_exec = temp.top();
+            next_exec = &executables_[temp.top()];
             temp.pop();
-            if(next_exec->can_be_run) {
+            {
                 std::cout << "_schedule_type: " << next_exec->sched_type;
                 std::cout << " chain_id: " << next_exec->chain_id;
                 std::cout << " is_first_in_chain: " << next_exec->is_first_in_chain;
                 //std::cout << " deadlines: " << (next_exec->deadlines == nullptr ? -1 : next_exec->deadlines->front())<< std::endl;
-                if(next_exec->deadlines == nullptr) {
+                if(next_exec->jobs == nullptr) {
                     std::cout << " deadlines nullptr";
                 } else {
-                    std::cout << " deadlines: " << (*next_exec->deadlines)[*next_exec->cur_index]->front();
-                    std::cout << " deadlines_size: " << (*next_exec->deadlines)[*next_exec->cur_index]->size();
-                    std::cout << " cur_index: " << *next_exec->cur_index;
+                    std::cout << " deadlines: " << get_current_deadline(next_exec);
+                    std::cout << " deadlines_size: " << next_exec->jobs->size();
+                    std::cout << " instance: " << get_current_instance(next_exec);
                 }
                 std::cout << " type: " << next_exec->type << std::endl;
                 //std::cout << " count_chain: " << *next_exec->sum << std::endl;
@@ -1361,21 +1785,447 @@ public:
         //std::cout << "time spend: " << millis1 - millis << std::endl;
     }
 private:
+    /// Invalidate the entity cache if the notify guard condition of a cached node fired.
+    void check_node_guard_conditions(const rcl_wait_set_t *wait_set)
+    {
+        // add_handles_to_wait_set() adds guard_conditions_ first, waitables may add more after them
+        for (size_t i = 0; i < guard_conditions_.size() && i < wait_set->size_of_guard_conditions; ++i)
+        {
+            if (wait_set->guard_conditions[i] != nullptr &&
+                std::find(node_guard_conditions_.begin(), node_guard_conditions_.end(), guard_conditions_[i]) !=
+                    node_guard_conditions_.end())
+            {
+                invalidate_entity_cache();
+                return;
+            }
+        }
+    }
+
+    /// Walk every node and group once and remember the entities and their settings.
+    void rebuild_entity_cache(const WeakNodeList &weak_nodes)
+    {
+        node_guard_conditions_.clear();
+        cached_groups_.clear();
+        cached_group_nodes_.clear();
+        resolved_.clear();
+        cached_subscriptions_.clear();
+        cached_services_.clear();
+        cached_clients_.clear();
+        cached_timers_.clear();
+        cached_waitables_.clear();
+        for (auto &weak_node : weak_nodes)
+        {
+            auto node = weak_node.lock();
+            if (!node)
+            {
+                continue;
+            }
+            node_guard_conditions_.push_back(node->get_notify_guard_condition());
+            for (auto &weak_group : node->get_callback_groups())
+            {
+                auto group = weak_group.lock();
+                if (!group)
+                {
+                    continue;
+                }
+                size_t group_index = cached_groups_.size();
+                cached_groups_.push_back(group);
+                cached_group_nodes_.push_back(node);
+                group->find_subscription_ptrs_if(
+                    [this, group_index](const rclcpp::SubscriptionBase::SharedPtr &subscription)
+                    {
+                        auto subscription_handle = subscription->get_subscription_handle();
+                        PriorityExecutable *t = get_priority_settings(subscription_handle);
+                        if (t == nullptr) return false;
+                        cached_subscriptions_.push_back({subscription_handle, t, group_index});
+                        cache_resolution(t, subscription, group_index);
+                        return false;
+                    });
+                group->find_service_ptrs_if(
+                    [this, group_index](const rclcpp::ServiceBase::SharedPtr &service)
+                    {
+                        auto service_handle = service->get_service_handle();
+                        PriorityExecutable *t = get_priority_settings(service_handle);
+                        if (t == nullptr) return false;
+                        cached_services_.push_back({service_handle, t, group_index});
+                        cache_resolution(t, service, group_index);
+                        return false;
+                    });
+                group->find_client_ptrs_if(
+                    [this, group_index](const rclcpp::ClientBase::SharedPtr &client)
+                    {
+                        auto client_handle = client->get_client_handle();
+                        PriorityExecutable *t = get_and_reset_priority(client_handle, CLIENT);
+                        cached_clients_.push_back({client_handle, t, group_index});
+                        cache_resolution(t, client, group_index);
+                        return false;
+                    });
+                group->find_timer_ptrs_if(
+                    [this, group_index](const rclcpp::TimerBase::SharedPtr &timer)
+                    {
+                        auto timer_handle = timer->get_timer_handle();
+                        PriorityExecutable *t = get_and_reset_priority(timer_handle, TIMER);
+                        cached_timers_.push_back({timer_handle, t, group_index});
+                        cache_resolution(t, timer, group_index);
+                        return false;
+                    });
+                group->find_waitable_ptrs_if(
+                    [this, group_index](const rclcpp::Waitable::SharedPtr &waitable)
+                    {
+                        PriorityExecutable *t = get_and_reset_priority(waitable, WAITABLE);
+                        t->waitable = waitable;
+                        cached_waitables_.push_back({waitable, t, group_index});
+                        cache_resolution(t, waitable, group_index);
+                        return false;
+                    });
+            }
+        }
+        entity_cache_valid_ = true;
+    }
+
+    void cache_resolution(const PriorityExecutable *exec, std::shared_ptr<void> entity, size_t group_index)
+    {
+        if (resolved_.size() <= exec->id)
+        {
+            resolved_.resize(exec->id + 1);
+        }
+        resolved_[exec->id].entity = entity;
+        resolved_[exec->id].group_index = group_index;
+    }
+
+    /// Entity, group and node of an executable.
+    /**
+     * Constant time for the entities found by the last collection, find_entity
+     * and find_group (rclcpp's walks over every node and group) are only used
+     * for the others, e.g. waitables given through add_waitable_handle().
+     */
+    template <typename EntityT, typename FindEntity, typename FindGroup>
+    std::shared_ptr<EntityT> resolve(
+        size_t id,
+        const WeakNodeList &weak_nodes,
+        rclcpp::CallbackGroup::SharedPtr &group,
+        rclcpp::node_interfaces::NodeBaseInterface::SharedPtr &node_base,
+        FindEntity find_entity,
+        FindGroup find_group)
+    {
+        if (id < resolved_.size() && resolved_[id].group_index != NO_GROUP)
+        {
+            const ResolvedEntity &resolved = resolved_[id];
+            std::shared_ptr<void> entity = resolved.entity.lock();
+            node_base = cached_group_nodes_[resolved.group_index].lock();
+            if (entity && node_base)
+            {
+                group = cached_groups_[resolved.group_index];
+                return std::static_pointer_cast<EntityT>(entity);
+            }
+        }
+        std::shared_ptr<EntityT> entity = find_entity();
+        group = entity ? find_group(entity) : nullptr;
+        node_base = group ? get_node_by_group(group, weak_nodes) : nullptr;
+        return entity;
+    }
+
+    bool has_expired_nodes(const WeakNodeList &weak_nodes) const
+    {
+        for (auto &weak_node : weak_nodes)
+        {
+            if (weak_node.expired())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Re-read can_be_taken_from of every cached group, returns whether any changed.
+    bool update_group_availability()
+    {
+        bool changed = group_can_be_taken_.size() != cached_groups_.size();
+        group_can_be_taken_.resize(cached_groups_.size());
+        for (size_t i = 0; i < cached_groups_.size(); ++i)
+        {
+            bool can_be_taken = cached_groups_[i]->can_be_taken_from().load();
+            if (group_can_be_taken_[i] != can_be_taken)
+            {
+                group_can_be_taken_[i] = can_be_taken;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // only the groups that can be taken from are waited on
+    void fill_handles()
+    {
+        for (auto &entity : cached_subscriptions_)
+        {
+            if (group_can_be_taken_[entity.group_index] && entity.exec->is_waited_on())
+            {
+                subscription_handles_.push_back(entity.handle);
+                subscription_execs_.push_back(entity.exec);
+            }
+        }
+        for (auto &entity : cached_services_)
+        {
+            if (group_can_be_taken_[entity.group_index] && entity.exec->is_waited_on())
+            {
+                service_handles_.push_back(entity.handle);
+                service_execs_.push_back(entity.exec);
+            }
+        }
+        for (auto &entity : cached_clients_)
+        {
+            if (group_can_be_taken_[entity.group_index] && entity.exec->is_waited_on())
+            {
+                client_handles_.push_back(entity.handle);
+                client_execs_.push_back(entity.exec);
+            }
+        }
+        for (auto &entity : cached_timers_)
+        {
+            if (group_can_be_taken_[entity.group_index] && entity.exec->is_waited_on())
+            {
+                timer_handles_.push_back(entity.handle);
+                timer_execs_.push_back(entity.exec);
+            }
+        }
+        for (auto &entity : cached_waitables_)
+        {
+            if (group_can_be_taken_[entity.group_index] && entity.exec->is_waited_on())
+            {
+                waitable_handles_.push_back(entity.handle);
+                waitable_execs_.push_back(entity.exec);
+            }
+        }
+    }
+
+    // an executable stays in the heap until it is dispatched or the wait set finds it idle
+    void mark_ready(const PriorityExecutable *exec, bool ready)
+    {
+        if (ready)
+        {
+            state_.sort_key[exec->id] = get_sort_key(exec);
+            all_executables_.push(exec->id);
+        }
+        else
+        {
+            all_executables_.remove(exec->id);
+        }
+    }
+
+    /// Re-key the ready stages of a chain after its deadline queues moved on.
+    void refresh_ready_deadlines(const ChainJobs *jobs)
+    {
+        if (jobs == nullptr)
+        {
+            return;
+        }
+        for (size_t id : jobs->dependents())
+        {
+            if (!all_executables_.contains(id))
+            {
+                continue;
+            }
+            const PriorityExecutable *exec = &executables_[id];
+            uint64_t sort_key = get_sort_key(exec);
+            if (state_.sort_key[id] != sort_key)
+            {
+                state_.sort_key[id] = sort_key;
+                all_executables_.update(id);
+            }
+        }
+    }
+
+    uint64_t get_current_deadline(const PriorityExecutable *exec) const
+    {
+        const Job *job = get_current_job(exec);
+        return job != nullptr ? job->deadline : 0;
+    }
+
+    /// The chain instance exec runs next.
+    uint64_t get_current_instance(const PriorityExecutable *exec) const
+    {
+        // instances the stage never saw, e.g. dropped messages, are completed already
+        return std::max(state_.instance[exec->id], exec->jobs->oldest_instance());
+    }
+
+    /// The outstanding job exec runs next, nullptr if it is not released yet.
+    const Job *get_current_job(const PriorityExecutable *exec) const
+    {
+        if (exec->sched_type != DEADLINE)
+        {
+            return nullptr;
+        }
+        if (!exec->join_inputs.empty())
+        {
+            // joins inherit the earliest deadline among their inputs
+            const Job *earliest = nullptr;
+            for (size_t i = 0; i < exec->join_inputs.size(); ++i)
+            {
+                const ChainJobs *jobs = exec->join_inputs[i];
+                const Job *job = jobs->find(std::max(exec->join_instances[i], jobs->oldest_instance()));
+                if (job != nullptr && (earliest == nullptr || job->deadline < earliest->deadline))
+                {
+                    earliest = job;
+                }
+            }
+            return earliest;
+        }
+        if (exec->jobs == nullptr)
+        {
+            return nullptr;
+        }
+        return exec->jobs->find(get_current_instance(exec));
+    }
+
+    /// Release the next instance of a chain and of every chain forked from it.
+    bool release_jobs(ChainJobs *jobs, uint64_t release_time)
+    {
+        const Job *job = jobs->release(release_time);
+        if (job != nullptr)
+        {
+            log_entry(logger, TRACE_JOB_RELEASE, job->chain_id, job->instance, job->release_time);
+            log_entry(logger, TRACE_JOB_DEADLINE, job->chain_id, job->instance, job->deadline);
+        }
+        else
+        {
+            log_entry(logger, TRACE_JOB_OVERFLOW, jobs->chain_id, jobs->next_instance(), release_time);
+        }
+        bool released = job != nullptr;
+        refresh_ready_deadlines(jobs);
+        for (ChainJobs *branch : jobs->branches)
+        {
+            released = release_jobs(branch, release_time) && released;
+        }
+        return released;
+    }
+
+    /// Whether releasing from also releases to, directly or through forks.
+    static bool reaches(const ChainJobs *from, const ChainJobs *to)
+    {
+        if (from == to)
+        {
+            return true;
+        }
+        for (const ChainJobs *branch : from->branches)
+        {
+            if (reaches(branch, to))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// The jobs of a chain, created by the first deadline executable registered for it.
+    ChainJobs *add_chain_jobs(int chain_id, int64_t period, int64_t deadline)
+    {
+        auto search = chain_jobs_.find(chain_id);
+        if (search == chain_jobs_.end())
+        {
+            // at least the instances released before the oldest one is due
+            int64_t overlap = period > 0 ? (deadline + period - 1) / period : 1;
+            search = chain_jobs_
+                         .emplace(std::piecewise_construct, std::forward_as_tuple(chain_id),
+                                  std::forward_as_tuple(chain_id, period, deadline,
+                                                        std::max<size_t>(chain_job_capacity_, overlap),
+                                                        timed_executor::memory_resource_of(*allocator_)))
+                         .first;
+        }
+        return &search->second;
+    }
+
+    /// The order of exec among the ready executables, taken from its settings and pending deadline.
+    uint64_t get_sort_key(const PriorityExecutable *exec) const
+    {
+        // deadline jobs first, then chain independent, then chain aware priorities
+        switch (exec->sched_type)
+        {
+        case DEADLINE:
+        {
+            uint64_t deadline = get_current_deadline(exec);
+            // without a pending deadline it runs after every deadline; equal
+            // deadlines, e.g. of forked branches, go by chain id, which never changes
+            int chain_id = state_.chain_id[exec->id];
+            return timed_executor::make_sort_key(0, deadline == 0 ? UINT64_MAX : deadline / 1000,
+                                                 chain_id < 0 ? 0 : (uint64_t)chain_id);
+        }
+        case CHAIN_INDEPENDENT_PRIORITY:
+            // lower value runs first
+            return timed_executor::make_sort_key(1, (uint64_t)((int64_t)exec->priority - INT32_MIN), 0);
+        case CHAIN_AWARE_PRIORITY:
+            // higher value runs first
+            return timed_executor::make_sort_key(2, (uint64_t)((int64_t)INT32_MAX - exec->priority), 0);
+        default:
+            return timed_executor::make_sort_key(3, 0, 0);
+        }
+    }
+
     PriorityExecutable *get_and_reset_priority(std::shared_ptr<const void> executable, ExecutableType t)
     {
         PriorityExecutable *p = get_priority_settings(executable);
         if (p == nullptr)
         {
-            priority_map[executable] = PriorityExecutable(executable, 0, t);
-            p = &(priority_map[executable]);
+            p = register_executable(executable, PriorityExecutable(executable, 0, t));
         }
-        // p->can_be_run = true;
         return p;
     }
 
+    /// Store the settings of handle, a handle that is registered again keeps its id.
+    PriorityExecutable *register_executable(std::shared_ptr<const void> handle, PriorityExecutable exec)
+    {
+        auto search = executable_ids_.find(handle);
+        if (search == executable_ids_.end())
+        {
+            search = executable_ids_.emplace(handle, executables_.size()).first;
+            executables_.emplace_back();
+            latencies_.emplace_back();
+            state_.resize(executables_.size());
+        }
+        exec.id = search->second;
+        // its key is about to change
+        all_executables_.remove(exec.id);
+        unlink_chain_jobs(&executables_[exec.id]);
+        executables_[exec.id] = exec;
+        link_chain_jobs(&executables_[exec.id]);
+        state_.reset(exec);
+        return &executables_[exec.id];
+    }
+
+    /// Register exec with the chains its deadline comes from, see refresh_ready_deadlines().
+    void link_chain_jobs(const PriorityExecutable *exec)
+    {
+        if (exec->jobs != nullptr)
+        {
+            exec->jobs->add_dependent(exec->id);
+        }
+        for (ChainJobs *jobs : exec->join_inputs)
+        {
+            jobs->add_dependent(exec->id);
+        }
+    }
+
+    void unlink_chain_jobs(const PriorityExecutable *exec)
+    {
+        if (exec->jobs != nullptr)
+        {
+            exec->jobs->remove_dependent(exec->id);
+        }
+        for (ChainJobs *jobs : exec->join_inputs)
+        {
+            jobs->remove_dependent(exec->id);
+        }
+    }
+
+    template <typename T>
+    using AllocRebind = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
     template <typename T>
-    using VectorRebind =
-        std::vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>>;
+    using VectorRebind = std::vector<T, AllocRebind<T>>;
+
+    using StateTable = ExecutableStateTable<Alloc>;
+    using Comparator = PriorityExecutableComparator<StateTable>;
+    using ReadyHeap = timed_executor::IndexedHeap<Comparator, AllocRebind<size_t>>;
 
     VectorRebind<const rcl_guard_condition_t *> guard_conditions_;
 
@@ -1385,15 +2235,73 @@ private:
     VectorRebind<std::shared_ptr<const rcl_timer_t>> timer_handles_;
     VectorRebind<std::shared_ptr<rclcpp::Waitable>> waitable_handles_;
 
+    // PriorityExecutable of every collected handle, index-aligned with the vectors above
+    VectorRebind<PriorityExecutable *> subscription_execs_;
+    VectorRebind<PriorityExecutable *> service_execs_;
+    VectorRebind<PriorityExecutable *> client_execs_;
+    VectorRebind<PriorityExecutable *> timer_execs_;
+    VectorRebind<PriorityExecutable *> waitable_execs_;
+
+    template <typename HandleT>
+    struct CachedEntity
+    {
+        HandleT handle;
+        PriorityExecutable *exec;
+        size_t group_index;
+    };
+
+    static constexpr size_t NO_GROUP = SIZE_MAX;
+
+    // the rclcpp entity behind an executable, by PriorityExecutable::id
+    struct ResolvedEntity
+    {
+        // weak, a destroyed entity falls back to the lookup through the nodes;
+        // holds the SubscriptionBase, ServiceBase, ... pointer as void
+        std::weak_ptr<void> entity;
+        size_t group_index = NO_GROUP;
+    };
+
+    // every entity of every node, only rebuilt when nodes, groups or settings change
+    bool entity_cache_valid_ = false;
+    // the handle lists were cleared or compacted since refresh_handles() filled them
+    bool handles_dirty_ = true;
+    // fired by a node when it creates entities, unlike the executor's interrupt guard condition
+    VectorRebind<const rcl_guard_condition_t *> node_guard_conditions_;
+    VectorRebind<rclcpp::CallbackGroup::SharedPtr> cached_groups_;
+    VectorRebind<rclcpp::node_interfaces::NodeBaseInterface::WeakPtr> cached_group_nodes_;
+    VectorRebind<bool> group_can_be_taken_;
+    VectorRebind<CachedEntity<std::shared_ptr<const rcl_subscription_t>>> cached_subscriptions_;
+    VectorRebind<CachedEntity<std::shared_ptr<const rcl_service_t>>> cached_services_;
+    VectorRebind<CachedEntity<std::shared_ptr<const rcl_client_t>>> cached_clients_;
+    VectorRebind<CachedEntity<std::shared_ptr<const rcl_timer_t>>> cached_timers_;
+    VectorRebind<CachedEntity<std::shared_ptr<rclcpp::Waitable>>> cached_waitables_;
+    VectorRebind<ResolvedEntity> resolved_;
+
     std::shared_ptr<VoidAlloc> allocator_;
 
     // TODO: evaluate using node/subscription namespaced strings as keys
 
-    // holds *all* handle->priority mappings
-    std::unordered_map<std::shared_ptr<const void>, PriorityExecutable> priority_map;
-
-    // hold *only valid* executable+priorities
-    std::priority_queue<const PriorityExecutable *, std::vector<const PriorityExecutable *>, PriorityExecutableComparator> all_executables_;
+    // holds *all* registered executables, indexed by PriorityExecutable::id;
+    // the handle is only hashed at registration and by the handle based calls
+    std::unordered_map<std::shared_ptr<const void>, size_t, std::hash<std::shared_ptr<const void>>,
+                       std::equal_to<std::shared_ptr<const void>>,
+                       AllocRebind<std::pair<const std::shared_ptr<const void>, size_t>>>
+        executable_ids_;
+    // a deque keeps the executables in place as it grows
+    std::deque<PriorityExecutable, AllocRebind<PriorityExecutable>> executables_;
+    // index-aligned with executables_, kept apart as the settings are copied in
+    std::deque<ExecutableLatencies, AllocRebind<ExecutableLatencies>> latencies_;
+    StateTable state_;
+
+    // hold *only ready* executable ids, kept across waits
+    ReadyHeap all_executables_;
+    // popped by get_next_executable() while their group was busy, pushed back before it returns
+    typename ReadyHeap::IdVector skipped_ids_;
+
+    // by chain id, shared by every stage of the chain
+    std::map<int, ChainJobs, std::less<int>, AllocRebind<std::pair<const int, ChainJobs>>> chain_jobs_;
+    size_t chain_job_capacity_ = 16;
+    bool record_latencies_ = false;
 };
 
 #endif // RCLCPP__STRATEGIES__ALLOCATOR_MEMORY_STRATEGY_HPP_
@@ -0,0 +1,375 @@
+#ifndef RTIS_READY_QUEUE
+#define RTIS_READY_QUEUE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace timed_executor
+{
+
+  /// Pack the order of a ready job into one integer, the smaller key runs first.
+  /**
+   * Policy class (2 bits) above the primary key (46 bits) above the tie break
+   * (16 bits); each field saturates instead of spilling into the next one.
+   * Deadlines are kept in nanoseconds everywhere else but keyed here in
+   * microseconds, which 46 bits hold for two years since boot; deadlines
+   * within the same microsecond fall to the tie break.
+   */
+  inline uint64_t make_sort_key(uint64_t policy_class, uint64_t primary, uint64_t tiebreak)
+  {
+    const uint64_t primary_max = (uint64_t(1) << 46) - 1;
+    const uint64_t tiebreak_max = (uint64_t(1) << 16) - 1;
+    return (std::min<uint64_t>(policy_class, 3) << 62) |
+           (std::min(primary, primary_max) << 16) |
+           std::min(tiebreak, tiebreak_max);
+  }
+
+  /// Test-and-set lock for the short ready queue critical sections.
+  class SpinLock
+  {
+  public:
+    void lock()
+    {
+      while (flag_.test_and_set(std::memory_order_acquire))
+      {
+        // workers may share a core with the holder under SCHED_FIFO
+        std::this_thread::yield();
+      }
+    }
+    bool try_lock()
+    {
+      return !flag_.test_and_set(std::memory_order_acquire);
+    }
+    void unlock()
+    {
+      flag_.clear(std::memory_order_release);
+    }
+
+  private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+  };
+
+  /// Deadline ordered queue that several threads push to and pop from without a global lock.
+  /**
+   * Entries are spread over a number of heaps, each behind its own SpinLock.
+   * The key at the head of every heap is cached in an atomic, so a pop only
+   * compares `choices` randomly picked heads (every head when choices is 0)
+   * and locks the heap with the smallest key. Ordering across heaps is
+   * therefore relaxed: with c heaps and two choices a pop returns one of the
+   * first O(c) keys. Smaller keys come out first, equal keys of one heap in
+   * push order.
+   */
+  template <typename T>
+  class MultiQueue
+  {
+  public:
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+
+    explicit MultiQueue(size_t number_of_queues, size_t choices = 2)
+        : queues_(number_of_queues == 0 ? 1 : number_of_queues), choices_(choices)
+    {
+    }
+
+    void push(uint64_t key, T value)
+    {
+      // EMPTY marks a heap without entries
+      key = std::min(key, EMPTY - 1);
+      while (true)
+      {
+        Queue &queue = queues_[random_index()];
+        if (!queue.lock.try_lock())
+        {
+          continue;
+        }
+        queue.heap.push_back(Entry{key, queue.sequence++, std::move(value)});
+        std::push_heap(queue.heap.begin(), queue.heap.end(), Later());
+        queue.head.store(queue.heap.front().key);
+        queue.lock.unlock();
+        return;
+      }
+    }
+
+    bool try_pop(T &value)
+    {
+      while (true)
+      {
+        Queue *queue = pick(choices_);
+        if (queue == nullptr)
+        {
+          // the sampled heads were empty, only give up when all of them are
+          queue = pick(0);
+          if (queue == nullptr)
+          {
+            return false;
+          }
+        }
+        if (!queue->lock.try_lock())
+        {
+          continue;
+        }
+        if (queue->heap.empty())
+        {
+          queue->lock.unlock();
+          continue;
+        }
+        std::pop_heap(queue->heap.begin(), queue->heap.end(), Later());
+        value = std::move(queue->heap.back().value);
+        queue->heap.pop_back();
+        queue->head.store(queue->heap.empty() ? EMPTY : queue->heap.front().key);
+        queue->lock.unlock();
+        return true;
+      }
+    }
+
+    /// Snapshot of the heads, may miss concurrent pushes and pops.
+    bool empty() const
+    {
+      for (auto &queue : queues_)
+      {
+        if (queue.head.load() != EMPTY)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    struct Entry
+    {
+      uint64_t key;
+      uint64_t sequence;
+      T value;
+    };
+
+    // makes the std heap functions build a min-heap
+    struct Later
+    {
+      bool operator()(const Entry &e1, const Entry &e2) const
+      {
+        if (e1.key != e2.key)
+        {
+          return e1.key > e2.key;
+        }
+        return e1.sequence > e2.sequence;
+      }
+    };
+
+    struct Queue
+    {
+      SpinLock lock;
+      std::atomic<uint64_t> head{EMPTY};
+      std::vector<Entry> heap;
+      uint64_t sequence = 0;
+      // keep neighbouring heads off each other's cache line
+      char padding[64];
+    };
+
+    size_t random_index()
+    {
+      static thread_local std::minstd_rand engine(std::hash<std::thread::id>()(std::this_thread::get_id()));
+      return engine() % queues_.size();
+    }
+
+    // no shared counter on purpose, it would be the one contended cache line
+    Queue *pick(size_t choices)
+    {
+      Queue *best = nullptr;
+      uint64_t best_key = EMPTY;
+      bool sample = choices != 0 && choices < queues_.size();
+      size_t count = sample ? choices : queues_.size();
+      for (size_t i = 0; i < count; ++i)
+      {
+        Queue &queue = queues_[sample ? random_index() : i];
+        uint64_t key = queue.head.load();
+        if (key < best_key)
+        {
+          best = &queue;
+          best_key = key;
+        }
+      }
+      return best;
+    }
+
+    std::vector<Queue> queues_;
+    size_t choices_;
+  };
+
+  template <typename T>
+  constexpr uint64_t MultiQueue<T>::EMPTY;
+
+  /// Binary heap of small integer ids that knows the position of every id.
+  /**
+   * An id is inserted once, moved in place when its key changes and removed
+   * without a search, each in O(log n). Compare has the std::priority_queue
+   * meaning: the id that is not less than any other is on top.
+   */
+  template <typename Compare, typename Allocator = std::allocator<size_t>>
+  class IndexedHeap
+  {
+  public:
+    static constexpr size_t NONE = SIZE_MAX;
+    using IdVector = std::vector<size_t, Allocator>;
+
+    explicit IndexedHeap(Compare compare = Compare(), const Allocator &allocator = Allocator())
+        : compare_(compare), heap_(allocator), position_(allocator)
+    {
+    }
+
+    bool empty() const
+    {
+      return heap_.empty();
+    }
+
+    size_t size() const
+    {
+      return heap_.size();
+    }
+
+    bool contains(size_t id) const
+    {
+      return id < position_.size() && position_[id] != NONE;
+    }
+
+    size_t top() const
+    {
+      return heap_.front();
+    }
+
+    /// The ids in heap order, not sorted.
+    const IdVector &ids() const
+    {
+      return heap_;
+    }
+
+    /// Insert id, or move it to its place if it is already in the heap.
+    void push(size_t id)
+    {
+      if (contains(id))
+      {
+        update(id);
+        return;
+      }
+      if (position_.size() <= id)
+      {
+        position_.resize(id + 1, NONE);
+      }
+      position_[id] = heap_.size();
+      heap_.push_back(id);
+      sift_up(heap_.size() - 1);
+    }
+
+    /// Restore the order after the key of id changed.
+    void update(size_t id)
+    {
+      if (!contains(id))
+      {
+        return;
+      }
+      sift_up(position_[id]);
+      sift_down(position_[id]);
+    }
+
+    void remove(size_t id)
+    {
+      if (!contains(id))
+      {
+        return;
+      }
+      size_t index = position_[id];
+      size_t last = heap_.back();
+      heap_.pop_back();
+      position_[id] = NONE;
+      if (index < heap_.size())
+      {
+        heap_[index] = last;
+        position_[last] = index;
+        sift_up(index);
+        sift_down(position_[last]);
+      }
+    }
+
+    void pop()
+    {
+      remove(heap_.front());
+    }
+
+    void clear()
+    {
+      for (size_t id : heap_)
+      {
+        position_[id] = NONE;
+      }
+      heap_.clear();
+    }
+
+  private:
+    // whether the entry at i belongs above the entry at j
+    bool above(size_t i, size_t j) const
+    {
+      return compare_(heap_[j], heap_[i]);
+    }
+
+    void swap_entries(size_t i, size_t j)
+    {
+      std::swap(heap_[i], heap_[j]);
+      position_[heap_[i]] = i;
+      position_[heap_[j]] = j;
+    }
+
+    void sift_up(size_t i)
+    {
+      while (i > 0)
+      {
+        size_t parent = (i - 1) / 2;
+        if (!above(i, parent))
+        {
+          return;
+        }
+        swap_entries(i, parent);
+        i = parent;
+      }
+    }
+
+    void sift_down(size_t i)
+    {
+      while (true)
+      {
+        size_t first = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < heap_.size() && above(left, first))
+        {
+          first = left;
+        }
+        if (right < heap_.size() && above(right, first))
+        {
+          first = right;
+        }
+        if (first == i)
+        {
+          return;
+        }
+        swap_entries(i, first);
+        i = first;
+      }
+    }
+
+    Compare compare_;
+    IdVector heap_;
+    // index into heap_ of every id, NONE when it is not in the heap
+    IdVector position_;
+  };
+
+  template <typename Compare, typename Allocator>
+  constexpr size_t IndexedHeap<Compare, Allocator>::NONE;
+
+} // namespace timed_executor
+#endif
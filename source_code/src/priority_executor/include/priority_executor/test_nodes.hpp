@@ -9,6 +9,7 @@ class PublisherNode : public rclcpp::Node
 {
 public:
   PublisherNode(std::string publish_topic, int chain, int period, double runtime);
+  PublisherNode(std::string publish_topic, int chain, std::chrono::nanoseconds period, double runtime);
 
   rclcpp::TimerBase::SharedPtr timer_;
   uint count_max = 20;
@@ -22,7 +23,7 @@ private:
   uint count_;
   int chain;
   double runtime;
-  int period;
+  std::chrono::nanoseconds period;
 };
 class DummyWorker : public rclcpp::Node
 {
@@ -1,12 +1,12 @@
 #include "rclcpp/rclcpp.hpp"
 #include "simple_timer/rt-sched.hpp"
+#include "simple_timer/trace_writer.hpp"
 #include "priority_executor/priority_memory_strategy.hpp"
 #include "priority_executor/priority_executor.hpp"
 #include "priority_executor/test_nodes.hpp"
 #include "priority_executor/default_executor.hpp"
 #include <iostream>
 #include <vector>
-#include <fstream>
 #include <unistd.h>
 
 
@@ -40,7 +40,6 @@ int main(int argc, char **argv) {
 	rclcpp::ExecutorOptions options;
 	options.memory_strategy = executors.strat;
 	executors.strat->logger = create_logger();
-	executors.strat->is_f1tenth = true;
 	executors.executor = std::make_shared<timed_executor::MultiThreadTimedExecutor>(options, NumThreads, YieldBeforeExecute, std::chrono::nanoseconds(-1), "multi_test");
     /*
     std::vector<uint64_t> chain_lengths = {2, 4};
@@ -64,9 +63,7 @@ int main(int argc, char **argv) {
 	std::vector<std::shared_ptr<PublisherNode>> publishers;
 	std::vector<std::shared_ptr<DummyWorker>> workers;
     node_time_logger logger = create_logger();
-	timespec current_time;
-	clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-	uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+	uint64_t millis = simple_timer::now_ns() / 1000000;
 	PublisherNode::set_end_time(millis + 50000);
 	DummyWorker::set_end_time(millis + 50000);
     uint64_t current_node_id = 0;
@@ -91,11 +88,9 @@ int main(int argc, char **argv) {
 					executors.strat->get_priority_settings(publisher_node->timer_->get_timer_handle())->timer_handle = this_chain_timer_handle;
                     executors.executor->add_node(publisher_node);
 
-					clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    				uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-    				uint64_t time_until_trigger = this_chain_timer_handle->time_until_trigger().count() / 1000000;
+    				uint64_t release = simple_timer::now_ns() + this_chain_timer_handle->time_until_trigger().count();
 					if (chain_index != 1)
-						log_entry(logger, std::to_string(chain_index) + " release_time: " + std::to_string(millis + time_until_trigger));
+						log_entry(logger, TRACE_RELEASE, chain_index, 0, release);
                 } 
                 nodes[chain_index].push_back(std::static_pointer_cast<rclcpp::Node>(publisher_node));
             }
@@ -123,45 +118,12 @@ int main(int argc, char **argv) {
             current_node_id++;	
         }
     }
+    std::string suffix = "";
+    simple_timer::TraceWriter trace_writer("experiments/arb_static" + std::to_string(NumThreads) + "c" + suffix + ".trace");
     executors.executor->spin();
     rclcpp::shutdown();
 
-	std::ofstream output_file;
-	std::string suffix = "";
-	output_file.open("experiments/arb_static" + std::to_string(NumThreads) + "c" + suffix + ".txt");
-	std::vector<std::pair<std::string, u64>> combined_logs;
-	for (auto &publisher : publishers)
-  	{
-    	for (auto &log : *(publisher->logger_.recorded_times))
-    	{
-     		combined_logs.push_back(log);
-    	}
-  	}
-
-	for (auto &worker : workers)
-  	{
-    	for (auto &log : *(worker->logger_.recorded_times))
-    	{
-      		combined_logs.push_back(log);
-    	}
-  	}
-
-	//combined_logs.push_back(*(executors.strat->logger.recorded_times));
-	for (auto &log : *(executors.strat->logger.recorded_times)) 
-	{
-		combined_logs.push_back(log);
-	}
-	for (auto &log : *(logger.recorded_times)) 
-	{
-		combined_logs.push_back(log);
-	}
-	std::sort(combined_logs.begin(), combined_logs.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b)
-        { return a.second < b.second; });
-	for (auto p : combined_logs)
-  	{
-    	output_file << p.second << " " << p.first << std::endl;
-  	}
-  	output_file.close();
+	trace_writer.stop();
   	std::cout<<"data written"<<std::endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Cost of ordering the ready executables: the comparator that follows every
+// executable to its chain's deadline queue and branches on the schedule types,
+// as PriorityExecutableComparator did, against comparing precomputed sort keys.
+// Every round releases all jobs into a heap and drains it again.
+#include "priority_executor/ready_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using timed_executor::make_sort_key;
+
+enum ScheduleType
+{
+  CHAIN_INDEPENDENT_PRIORITY,
+  CHAIN_AWARE_PRIORITY,
+  DEADLINE,
+};
+
+struct Executable
+{
+  ScheduleType sched_type = DEADLINE;
+  int priority = 0;
+  int counter = 0;
+  int *cur_index = nullptr;
+  std::vector<std::deque<unsigned> *> *deadlines = nullptr;
+};
+
+// the comparator before the sort keys, minus its debug output
+struct PointerComparator
+{
+  const std::vector<Executable *> *executables;
+
+  bool operator()(size_t id1, size_t id2) const
+  {
+    const Executable *p1 = (*executables)[id1];
+    const Executable *p2 = (*executables)[id2];
+    if (p1->sched_type != p2->sched_type)
+    {
+      if (p1->sched_type == DEADLINE)
+      {
+        return false;
+      }
+      else if (p2->sched_type == DEADLINE)
+      {
+        return true;
+      }
+      return p1->sched_type != CHAIN_INDEPENDENT_PRIORITY;
+    }
+    if (p1->sched_type == CHAIN_INDEPENDENT_PRIORITY)
+    {
+      return p1->priority > p2->priority;
+    }
+    if (p1->sched_type == CHAIN_AWARE_PRIORITY)
+    {
+      return p1->priority < p2->priority;
+    }
+    unsigned p1_deadline = 0;
+    unsigned p2_deadline = 0;
+    if (p1->deadlines != nullptr && !(*p1->deadlines)[*p1->cur_index]->empty())
+    {
+      p1_deadline = (*p1->deadlines)[*p1->cur_index]->front();
+    }
+    if (p2->deadlines != nullptr && !(*p2->deadlines)[*p2->cur_index]->empty())
+    {
+      p2_deadline = (*p2->deadlines)[*p2->cur_index]->front();
+    }
+    if (p1_deadline == 0)
+    {
+      return true;
+    }
+    if (p2_deadline == 0)
+    {
+      return false;
+    }
+    if (p1_deadline == p2_deadline)
+    {
+      return p1->counter > p2->counter;
+    }
+    return p1_deadline > p2_deadline;
+  }
+};
+
+struct KeyComparator
+{
+  const std::vector<uint64_t> *sort_keys;
+
+  bool operator()(size_t id1, size_t id2) const
+  {
+    return (*sort_keys)[id1] > (*sort_keys)[id2];
+  }
+};
+
+// nanoseconds per released and dispatched job
+template <typename Compare>
+double run(Compare compare, size_t jobs, size_t rounds)
+{
+  std::vector<size_t> heap;
+  heap.reserve(jobs);
+  size_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < rounds; ++round)
+  {
+    for (size_t id = 0; id < jobs; ++id)
+    {
+      heap.push_back(id);
+      std::push_heap(heap.begin(), heap.end(), compare);
+    }
+    while (!heap.empty())
+    {
+      std::pop_heap(heap.begin(), heap.end(), compare);
+      checksum += heap.back();
+      heap.pop_back();
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  if (checksum == 0 && jobs > 1)
+  {
+    std::cerr << "unexpected checksum" << std::endl;
+  }
+  return elapsed.count() / (jobs * rounds);
+}
+
+int main(int argc, char **argv)
+{
+  size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  const size_t stages = 4;
+  const size_t slots = 2;
+  std::mt19937 engine(42);
+  std::cout << "jobs,pointer_ns,key_ns" << std::endl;
+  for (size_t jobs : {16, 64, 256, 1024})
+  {
+    // chains of four stages share their deadline queues, as set up by the drivers
+    std::vector<std::unique_ptr<std::vector<std::deque<unsigned> *>>> chains;
+    std::vector<std::unique_ptr<std::deque<unsigned>>> queues;
+    std::vector<std::unique_ptr<int>> indices;
+    std::vector<std::unique_ptr<Executable>> storage;
+    // scattered like executables registered between other allocations
+    std::vector<std::unique_ptr<char[]>> padding;
+    std::vector<Executable *> executables;
+    std::vector<uint64_t> sort_keys;
+    for (size_t id = 0; id < jobs; ++id)
+    {
+      if (id % stages == 0)
+      {
+        chains.emplace_back(new std::vector<std::deque<unsigned> *>());
+        for (size_t slot = 0; slot < slots; ++slot)
+        {
+          queues.emplace_back(new std::deque<unsigned>());
+          for (int instance = 0; instance < 3; ++instance)
+          {
+            queues.back()->push_back(1000000 + engine() % 100000);
+          }
+          chains.back()->push_back(queues.back().get());
+        }
+      }
+      padding.emplace_back(new char[64 + engine() % 512]);
+      storage.emplace_back(new Executable());
+      Executable *exec = storage.back().get();
+      indices.emplace_back(new int(engine() % slots));
+      exec->cur_index = indices.back().get();
+      exec->deadlines = chains.back().get();
+      exec->counter = engine() % 1000;
+      executables.push_back(exec);
+      uint64_t deadline = (*exec->deadlines)[*exec->cur_index]->front();
+      sort_keys.push_back(make_sort_key(0, deadline, exec->counter));
+    }
+    double pointer_ns = run(PointerComparator{&executables}, jobs, rounds);
+    double key_ns = run(KeyComparator{&sort_keys}, jobs, rounds);
+    std::cout << jobs << "," << pointer_ns << "," << key_ns << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,207 @@
+#include "priority_executor/cpu_topology.hpp"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace timed_executor
+{
+
+  std::vector<int> parse_cpu_list(const std::string &list)
+  {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+      if (range.empty() || range == "\n")
+      {
+        continue;
+      }
+      size_t dash = range.find('-');
+      try
+      {
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+          cpus.push_back(cpu);
+        }
+      }
+      catch (const std::exception &)
+      {
+        // malformed entry, ignore it
+      }
+    }
+    return cpus;
+  }
+
+  static bool read_line(const std::string &path, std::string &line)
+  {
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, line));
+  }
+
+  static int read_int(const std::string &path, int fallback)
+  {
+    std::string line;
+    if (!read_line(path, line))
+    {
+      return fallback;
+    }
+    try
+    {
+      return std::stoi(line);
+    }
+    catch (const std::exception &)
+    {
+      return fallback;
+    }
+  }
+
+  std::vector<CpuInfo> read_cpu_topology(const std::string &root)
+  {
+    std::vector<CpuInfo> topology;
+    std::string line;
+    if (!read_line(root + "/online", line))
+    {
+      return topology;
+    }
+    std::vector<int> online = parse_cpu_list(line);
+
+    std::set<int> isolated;
+    if (read_line(root + "/isolated", line))
+    {
+      std::vector<int> isolated_list = parse_cpu_list(line);
+      isolated.insert(isolated_list.begin(), isolated_list.end());
+    }
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool have_affinity = sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0;
+
+    for (int cpu : online)
+    {
+      std::string dir = root + "/cpu" + std::to_string(cpu);
+      CpuInfo info;
+      info.cpu = cpu;
+      info.core_id = read_int(dir + "/topology/core_id", cpu);
+      info.package_id = read_int(dir + "/topology/physical_package_id", 0);
+      info.isolated = isolated.count(cpu) != 0;
+      info.allowed = !have_affinity || CPU_ISSET(cpu, &allowed);
+
+      // the highest cache level is the last level cache
+      info.llc_id = cpu;
+      int llc_level = -1;
+      for (int index = 0;; ++index)
+      {
+        std::string cache = dir + "/cache/index" + std::to_string(index);
+        int level = read_int(cache + "/level", -1);
+        if (level < 0)
+        {
+          break;
+        }
+        std::vector<int> shared;
+        if (level > llc_level && read_line(cache + "/shared_cpu_list", line) &&
+            !(shared = parse_cpu_list(line)).empty())
+        {
+          llc_level = level;
+          info.llc_id = *std::min_element(shared.begin(), shared.end());
+        }
+      }
+      topology.push_back(info);
+    }
+    return topology;
+  }
+
+  std::vector<int> choose_worker_cpus(size_t count, const std::vector<CpuInfo> &topology)
+  {
+    std::vector<int> chosen;
+    if (count == 0)
+    {
+      return chosen;
+    }
+
+    // preferred: one cpu per physical core, neither housekeeping nor isolated
+    std::vector<const CpuInfo *> preferred;
+    std::vector<const CpuInfo *> siblings;
+    std::vector<const CpuInfo *> reserved;
+    std::set<std::pair<int, int>> cores;
+    // first the cores of housekeeping and isolated cpus, whichever order their
+    // SMT siblings come in: those siblings only count as siblings
+    for (auto &info : topology)
+    {
+      if (info.cpu == 0 || info.isolated)
+      {
+        cores.insert(std::make_pair(info.package_id, info.core_id));
+      }
+    }
+    for (auto &info : topology)
+    {
+      if (!info.allowed)
+      {
+        continue;
+      }
+      if (info.cpu == 0 || info.isolated)
+      {
+        reserved.push_back(&info);
+      }
+      else if (cores.insert(std::make_pair(info.package_id, info.core_id)).second)
+      {
+        preferred.push_back(&info);
+      }
+      else
+      {
+        siblings.push_back(&info);
+      }
+    }
+
+    // fill from the last level cache with the most preferred cpus first
+    std::map<int, size_t> llc_sizes;
+    for (auto info : preferred)
+    {
+      llc_sizes[info->llc_id]++;
+    }
+    auto by_llc = [&llc_sizes](const CpuInfo *c1, const CpuInfo *c2)
+    {
+      if (llc_sizes[c1->llc_id] != llc_sizes[c2->llc_id])
+      {
+        return llc_sizes[c1->llc_id] > llc_sizes[c2->llc_id];
+      }
+      return c1->llc_id < c2->llc_id;
+    };
+    std::stable_sort(preferred.begin(), preferred.end(), by_llc);
+    std::stable_sort(siblings.begin(), siblings.end(), by_llc);
+
+    for (auto *candidates : {&preferred, &siblings, &reserved})
+    {
+      for (auto info : *candidates)
+      {
+        if (chosen.size() == count)
+        {
+          return chosen;
+        }
+        chosen.push_back(info->cpu);
+      }
+    }
+    if (chosen.empty())
+    {
+      // no topology available, keep the old thread id placement
+      for (size_t i = 0; i < count; ++i)
+      {
+        chosen.push_back(static_cast<int>(i));
+      }
+      return chosen;
+    }
+    for (size_t i = 0; chosen.size() < count; ++i)
+    {
+      chosen.push_back(chosen[i]);
+    }
+    return chosen;
+  }
+
+} // namespace timed_executor
@@ -51,14 +51,11 @@ void ROSDefaultExecutor::spin()
       {
         if (priority_map.find(any_executable.timer->get_timer_handle()) != priority_map.end())
         {
-          timespec current_time;
-          clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-          uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
           PriorityExecutable next_exec = priority_map[any_executable.timer->get_timer_handle()];
 
           auto timer = next_exec.timer_handle;
           // TODO: this is really a fire
-          log_entry(logger, "timer_" + std::to_string(next_exec.chain_id) + "_release_" + std::to_string(millis + (timer->time_until_trigger().count() / 1000000)));
+          log_entry(logger, TRACE_TIMER_RELEASE, next_exec.chain_id, 0, simple_timer::now_ns() + timer->time_until_trigger().count());
         }
       }
       execute_any_executable(any_executable);
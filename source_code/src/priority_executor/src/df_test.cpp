@@ -1,10 +1,10 @@
 #include "rclcpp/rclcpp.hpp"
 #include "simple_timer/rt-sched.hpp"
+#include "simple_timer/trace_writer.hpp"
 #include "priority_executor/test_nodes.hpp"
 
 #include <iostream>
 #include <vector>
-#include <fstream>
 #include <unistd.h>
 
 
@@ -25,7 +25,6 @@ int main(int argc, char **argv) {
 	std::vector<std::shared_ptr<PublisherNode>> publishers;
 	std::vector<std::shared_ptr<DummyWorker>> workers;
     node_time_logger logger = create_logger();
-	timespec current_time;
     uint64_t current_node_id = 0;
     for (uint chain_index = 0; chain_index < chain_lengths.size(); ++chain_index) {
         std::shared_ptr<rclcpp::TimerBase> this_chain_timer_handle;
@@ -49,11 +48,9 @@ int main(int argc, char **argv) {
 					//executors.strat->get_priority_settings(publisher_node->timer_->get_timer_handle())->timer_handle = this_chain_timer_handle;
                     //executors.executor->add_node(publisher_node);
 
-					clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    				uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-    				uint64_t time_until_trigger = this_chain_timer_handle->time_until_trigger().count() / 1000000;
+    				uint64_t release = simple_timer::now_ns() + this_chain_timer_handle->time_until_trigger().count();
 					if (chain_index != 1)
-						log_entry(logger, std::to_string(chain_index) + " release_time: " + std::to_string(millis + time_until_trigger));
+						log_entry(logger, TRACE_RELEASE, chain_index, 0, release);
                 } 
                 nodes[chain_index].push_back(std::static_pointer_cast<rclcpp::Node>(publisher_node));
             }
@@ -84,41 +81,12 @@ int main(int argc, char **argv) {
     }
 
 
+    std::string suffix = "";
+    simple_timer::TraceWriter trace_writer("experiments/df_test" + std::to_string(NumThreads) + "c" + suffix + ".trace");
     exec1.spin();
     rclcpp::shutdown();
 
-	std::ofstream output_file;
-	std::string suffix = "";
-	output_file.open("experiments/df_test" + std::to_string(NumThreads) + "c" + suffix + ".txt");
-	std::vector<std::pair<std::string, u64>> combined_logs;
-	for (auto &publisher : publishers)
-  	{
-    	for (auto &log : *(publisher->logger_.recorded_times))
-    	{
-     		combined_logs.push_back(log);
-    	}
-  	}
-
-	for (auto &worker : workers)
-  	{
-    	for (auto &log : *(worker->logger_.recorded_times))
-    	{
-      		combined_logs.push_back(log);
-    	}
-  	}
-
-	//combined_logs.push_back(*(executors.strat->logger.recorded_times));
-	for (auto &log : *(logger.recorded_times)) 
-	{
-		combined_logs.push_back(log);
-	}
-	std::sort(combined_logs.begin(), combined_logs.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b)
-        { return a.second < b.second; });
-	for (auto p : combined_logs)
-  	{
-    	output_file << p.second << " " << p.first << std::endl;
-  	}
-  	output_file.close();
+	trace_writer.stop();
   	std::cout<<"data written"<<std::endl;
     return 0;
 }
\ No newline at end of file
@@ -1,11 +1,11 @@
 #include "rclcpp/rclcpp.hpp"
 #include "simple_timer/rt-sched.hpp"
+#include "simple_timer/trace_writer.hpp"
 #include "priority_executor/priority_memory_strategy.hpp"
 #include "priority_executor/priority_executor.hpp"
 #include "priority_executor/test_nodes.hpp"
 #include "priority_executor/default_executor.hpp"
 #include <vector>
-#include <fstream>
 #include <unistd.h>
 
 typedef struct
@@ -16,6 +16,10 @@ typedef struct
   std::shared_ptr<ROSDefaultExecutor> default_executor;
 } executor_strat;
 
+uint64_t PublisherNode::end_time;
+uint64_t DummyWorker::end_time;
+uint64_t MuExWorker::ed_time;
+
 void spin_exec(executor_strat strat, int id, int index)
 {
   cpu_set_t cpuset;
@@ -107,7 +111,6 @@ int main(int argc, char **argv)
       rclcpp::ExecutorOptions options;
       options.memory_strategy = executor.strat;
       executor.strat->logger = create_logger();
-      executor.strat->is_f1tenth = true;
 
       executor.executor = std::make_shared<timed_executor::TimedExecutor>(options);
       executor.executor->set_use_priorities(true);
@@ -130,14 +133,15 @@ int main(int argc, char **argv)
   std::vector<std::vector<std::shared_ptr<rclcpp::Node>>> nodes;
   std::vector<std::shared_ptr<PublisherNode>> publishers;
   std::vector<std::shared_ptr<DummyWorker>> workers;
-  std::vector<std::deque<uint> *> chain_deadlines_deque;
+  uint64_t millis = simple_timer::now_ns() / 1000000;
+  PublisherNode::set_end_time(millis + 50000);
+  DummyWorker::set_end_time(millis + 50000);
   // create nodes and assign to executors
   uint64_t current_node_id = 0;
   for (uint chain_index = 0; chain_index < chain_lengths.size(); chain_index++)
   {
     std::cout << "making chain " << std::to_string(chain_index) << std::endl;
     std::shared_ptr<rclcpp::TimerBase> this_chain_timer_handle;
-    std::deque<uint> *this_chain_deadlines_deque = new std::deque<uint>();
     nodes.push_back(std::vector<std::shared_ptr<rclcpp::Node>>());
     for (uint cb_index = 0; cb_index < chain_lengths[chain_index]; cb_index++)
     {
@@ -165,7 +169,7 @@ int main(int argc, char **argv)
             assert(this_executor.strat != nullptr);
             auto timer_handle = publisher_node->timer_->get_timer_handle();
             assert(timer_handle != nullptr);
-            this_executor.strat->set_executable_deadline(publisher_node->timer_->get_timer_handle(), chain_deadlines[chain_index], TIMER, chain_index);
+            this_executor.strat->set_executable_deadline(publisher_node->timer_->get_timer_handle(), chain_periods[chain_index], chain_deadlines[chain_index], TIMER, chain_index);
           }
           else if (schedule_type == CHAIN_AWARE_PRIORITY)
           {
@@ -183,7 +187,6 @@ int main(int argc, char **argv)
           else
           {
             this_executor.strat->set_first_in_chain(publisher_node->timer_->get_timer_handle());
-            this_executor.strat->assign_deadlines_queue(publisher_node->timer_->get_timer_handle(), this_chain_deadlines_deque);
             this_chain_timer_handle = publisher_node->timer_;
             this_executor.strat->get_priority_settings(publisher_node->timer_->get_timer_handle())->timer_handle = this_chain_timer_handle;
             this_executor.executor->add_node(publisher_node);
@@ -207,7 +210,13 @@ int main(int argc, char **argv)
         workers.push_back(sub_node);
         if (schedule_type == DEADLINE)
         {
-          this_executor.strat->set_executable_deadline(sub_node->subscription_->get_subscription_handle(), chain_deadlines[chain_index], SUBSCRIPTION, chain_index);
+          this_executor.strat->set_executable_deadline(sub_node->subscription_->get_subscription_handle(), chain_periods[chain_index], chain_deadlines[chain_index], SUBSCRIPTION, chain_index);
+          if (chain_index == 1 && cb_index == 1)
+          {
+            // the timer chain 1 shares with chain 0 runs on another executor,
+            // so the first worker releases the instances of chain 1 on this one
+            this_executor.strat->set_first_in_chain(sub_node->subscription_->get_subscription_handle());
+          }
         }
         else if (schedule_type == CHAIN_AWARE_PRIORITY)
         {
@@ -221,7 +230,6 @@ int main(int argc, char **argv)
         else
         {
           this_executor.executor->add_node(sub_node);
-          this_executor.strat->assign_deadlines_queue(sub_node->subscription_->get_subscription_handle(), this_chain_deadlines_deque);
           if (cb_index == chain_lengths[chain_index] - 1)
           {
             this_executor.strat->set_last_in_chain(sub_node->subscription_->get_subscription_handle());
@@ -232,106 +240,55 @@ int main(int argc, char **argv)
       }
       current_node_id++;
     }
-    chain_deadlines_deque.push_back(this_chain_deadlines_deque);
   }
   std::cout << "initialized nodes" << std::endl;
   node_time_logger logger = create_logger();
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
   for (uint chain_index = 0; chain_index < chain_lengths.size(); chain_index++)
   {
+    auto this_chain_timer_handle = std::static_pointer_cast<PublisherNode>(nodes[chain_index][0])->timer_;
+    uint64_t release = simple_timer::now_ns() + this_chain_timer_handle->time_until_trigger().count();
     if (schedule_type == DEADLINE)
     {
-
-      log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + chain_deadlines[chain_index]));
-	    std::cout << "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + chain_deadlines[chain_index]) << std::endl;
-	}
-    log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis));
-    std::cout << "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis) << std::endl;
-    chain_deadlines_deque[chain_index]->push_back(millis + chain_deadlines[chain_index]);
-    // chain_deadlines_deque[chain_index]->push_back(0);
+      // on the executor of the chain's first deadline stage
+      executor_strat this_executor = executors[node_executor_assignment[chain_index][chain_index == 1 ? 1 : 0] % NUM_EXECUTORS];
+      this_executor.strat->release_chain_job(chain_index, std::chrono::nanoseconds(release));
+      log_entry(logger, TRACE_DEADLINE, chain_index, 0, release + chain_deadlines[chain_index] * 1000000);
+      std::cout << "deadline_" + std::to_string(chain_index) + "_" + std::to_string(release / 1000000 + chain_deadlines[chain_index]) << std::endl;
+    }
+    log_entry(logger, TRACE_TIMER_RELEASE, chain_index, 0, release);
+    std::cout << "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(release / 1000000) << std::endl;
   }
 
-  std::vector<std::thread> threads;
-  // start each executor on it's own thread
-  for (int i = 0; i < NUM_EXECUTORS; i++)
-  {
-    executor_strat strat = executors[i];
-    auto func = std::bind(spin_exec, strat, executor_cpu_assignment[i], i);
-    threads.emplace_back(func);
-  }
-  for (auto &thread : threads)
-  {
-    thread.join();
-  }
-  rclcpp::shutdown();
-/*
-  for (auto &log : logger) {
-	std::cout << log << std::endl;
-  }
-*/
-  std::ofstream output_file;
   // useful if testing different variations
   std::string suffix = "";
+  std::string trace_path;
   if (schedule_type == DEADLINE)
   {
-    output_file.open("experiments/results/f1tenth_full" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".txt");
+    trace_path = "experiments/results/f1tenth_full" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".trace";
   }
   else if (schedule_type == CHAIN_AWARE_PRIORITY)
   {
-    output_file.open("experiments/results/f1tenth_full_chain" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".txt");
+    trace_path = "experiments/results/f1tenth_full_chain" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".trace";
   }
   else
   {
-    output_file.open("experiments/results/f1tenth_default" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".txt");
+    trace_path = "experiments/results/f1tenth_default" + std::to_string(NUM_EXECUTORS) + "c" + suffix + ".trace";
   }
+  simple_timer::TraceWriter trace_writer(trace_path);
 
-  std::vector<std::pair<std::string, u64>> combined_logs;
-  for (auto &publisher : publishers)
-  {
-    for (auto &log : *(publisher->logger_.recorded_times))
-    {
-      combined_logs.push_back(log);
-    }
-  }
-
-  for (auto &worker : workers)
-  {
-    for (auto &log : *(worker->logger_.recorded_times))
-    {
-      combined_logs.push_back(log);
-    }
-  }
-
-  if (schedule_type == DEFAULT)
-  {
-    for (auto &executor : executors)
-    {
-      for (auto &log : *(executor.default_executor->logger.recorded_times))
-      {
-        combined_logs.push_back(log);
-      }
-    }
-  }
-  else
+  std::vector<std::thread> threads;
+  // start each executor on it's own thread
+  for (int i = 0; i < NUM_EXECUTORS; i++)
   {
-    for (auto &executor : executors)
-    {
-      for (auto &log : *(executor.strat->logger.recorded_times))
-      {
-        combined_logs.push_back(log);
-      }
-    }
+    executor_strat strat = executors[i];
+    auto func = std::bind(spin_exec, strat, executor_cpu_assignment[i], i);
+    threads.emplace_back(func);
   }
-
-  std::sort(combined_logs.begin(), combined_logs.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b)
-            { return a.second < b.second; });
-
-  for (auto p : combined_logs)
+  for (auto &thread : threads)
   {
-    output_file << p.second << " " << p.first << std::endl;
+    thread.join();
   }
-  output_file.close();
+  rclcpp::shutdown();
+  trace_writer.stop();
   std::cout<<"data written"<<std::endl;
 }
@@ -51,7 +51,6 @@ int main(int argc, char **argv) {
 	rclcpp::ExecutorOptions options;
 	options.memory_strategy = executors.strat;
 	executors.strat->logger = create_logger();
-	executors.strat->is_f1tenth = false;
 	executors.executor = std::make_shared<timed_executor::MultiThreadTimedExecutor>(options, NumThreads, YieldBeforeExecute, std::chrono::nanoseconds(-1), "multi_test");
 	//executors.executor->set_use_priorities(true);
 
@@ -89,10 +88,7 @@ int main(int argc, char **argv) {
     std::vector<std::vector<std::shared_ptr<rclcpp::Node>>> nodes;
 	std::vector<std::shared_ptr<PublisherNode>> publishers;
 	std::vector<std::shared_ptr<DummyWorker>> workers;
-	std::vector<std::vector<std::deque<uint> *> *> chain_deadlines_deque;
-	timespec current_time;
-	clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-	uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+	uint64_t millis = simple_timer::now_ns() / 1000000;
 	PublisherNode::set_end_time(millis + 50000);
 	DummyWorker::set_end_time(millis + 50000);
     uint64_t current_node_id = 0;
@@ -100,10 +96,6 @@ int main(int argc, char **argv) {
 		std::cout << "making chain" << std::to_string(chain_index) << std::endl;
 		std::shared_ptr<rclcpp::TimerBase> this_chain_timer_handle;
 
-		int max_chain_num = std::ceil(chain_deadlines[chain_index] / (double)chain_periods[chain_index]);
-		std::vector<std::deque<uint> *>* this_chain_deadlines_deque = new std::vector<std::deque<uint> *>(max_chain_num, nullptr);
-		for(uint index = 0; index < max_chain_num; ++index) (*this_chain_deadlines_deque)[index] = new std::deque<uint>();
-		//std::deque<uint> *this_chain_deadlines_deque = new std::deque<uint>();
 		nodes.push_back(std::vector<std::shared_ptr<rclcpp::Node>>());
 		
 		for (uint cb_index = 0; cb_index < chain_lengths[chain_index]; cb_index++) {
@@ -125,11 +117,6 @@ int main(int argc, char **argv) {
 
 				executors.strat->set_first_in_chain(publisher_node->timer_->get_timer_handle());
 
-					//if (executors.strat->is_f1tenth && chain_index == 0)
-					//	executors.strat->assign_deadlines_queue(publisher_node->timer_->get_timer_handle(), shared_chain_deadlines_deque);
-					//else 
-				executors.strat->assign_deadlines_queue(publisher_node->timer_->get_timer_handle(), this_chain_deadlines_deque);
-
 				this_chain_timer_handle = publisher_node->timer_;
 				executors.strat->get_priority_settings(publisher_node->timer_->get_timer_handle())->timer_handle = this_chain_timer_handle;
 				executors.executor->add_node(publisher_node);
@@ -154,7 +141,6 @@ int main(int argc, char **argv) {
 				workers.push_back(sub_node);
 				executors.strat->set_executable_deadline(sub_node->subscription_->get_subscription_handle(), chain_periods[chain_index], chain_deadlines[chain_index], SUBSCRIPTION, chain_index);
 				executors.executor->add_node(sub_node);
-				executors.strat->assign_deadlines_queue(sub_node->subscription_->get_subscription_handle(), this_chain_deadlines_deque);
 				if (cb_index == chain_lengths[chain_index] - 1) {
 					executors.strat->set_last_in_chain(sub_node->subscription_->get_subscription_handle());
 					executors.strat->get_priority_settings(sub_node->subscription_->get_subscription_handle())->timer_handle = this_chain_timer_handle;
@@ -163,17 +149,6 @@ int main(int argc, char **argv) {
 			}
 			current_node_id++;			
 		}
-		chain_deadlines_deque.push_back(this_chain_deadlines_deque);
-		/*
-		clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-		uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-		
-		log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + chain_deadlines[chain_index]));
-		log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis));
-		std::cout << "chain_index: " << chain_index << " " << "deadlines: " << millis + chain_deadlines[chain_index] << std::endl;
-		std::cout << " release: " << millis << std::endl;
-		chain_deadlines_deque[chain_index]->push_back(millis + chain_deadlines[chain_index]); 
-		*/
 	}
 	std::cout << "initialized nodes" << std::endl;
 	
@@ -187,17 +162,14 @@ int main(int argc, char **argv) {
 
 		this_chain_timer_handle = std::static_pointer_cast<PublisherNode>(nodes[chain_index][0])->timer_;
 		
-		clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-		uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-		uint64_t time_until_trigger = this_chain_timer_handle->time_until_trigger().count() / 1000000;
-		log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + time_until_trigger + chain_deadlines[chain_index]));
-		log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis + time_until_trigger));
-		std::cout << "chain_index: " << chain_index << " " << "deadlines: " << millis + time_until_trigger + chain_deadlines[chain_index] << std::endl;
-		std::cout << " release: " << millis + time_until_trigger << std::endl;
+		uint64_t release = simple_timer::now_ns() + this_chain_timer_handle->time_until_trigger().count();
+		log_entry(logger, TRACE_DEADLINE, chain_index, 0, release + chain_deadlines[chain_index] * 1000000);
+		log_entry(logger, TRACE_TIMER_RELEASE, chain_index, 0, release);
+		std::cout << "chain_index: " << chain_index << " " << "deadlines: " << release / 1000000 + chain_deadlines[chain_index] << std::endl;
+		std::cout << " release: " << release / 1000000 << std::endl;
 		std::cout << " time_until_trigger: " << (this_chain_timer_handle->time_until_trigger().count() / 1000000) << std::endl;
 		//chain_deadlines_deque[chain_index + 1]->push_back(millis + chain_deadlines[chain_index]);
-		executors.strat->assign_release_time(this_chain_timer_handle->get_timer_handle(), millis + time_until_trigger);
-		(*chain_deadlines_deque[chain_index])[0]->push_back(millis + time_until_trigger + chain_deadlines[chain_index]);
+		executors.strat->release_chain_job(chain_index, std::chrono::nanoseconds(release));
 		//chain_deadlines_deque[chain_index]->push_back(millis + time_until_trigger + chain_deadlines[chain_index]);
 	}
 	
@@ -214,8 +186,7 @@ int main(int argc, char **argv) {
 	//executors.executor.cpus = {};
 	executors.strat->print_all_handle_schedule_type();
 	
-	clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-	millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+	millis = simple_timer::now_ns() / 1000000;
 	std::cout << "spin time: " << millis << std::endl;
 	std::cout << "---------------" << std::endl;
 	executors.executor->spin();
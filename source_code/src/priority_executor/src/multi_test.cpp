@@ -1,12 +1,12 @@
 #include "rclcpp/rclcpp.hpp"
 #include "simple_timer/rt-sched.hpp"
+#include "simple_timer/trace_writer.hpp"
 #include "priority_executor/priority_memory_strategy.hpp"
 #include "priority_executor/priority_executor.hpp"
 #include "priority_executor/test_nodes.hpp"
 #include "priority_executor/default_executor.hpp"
 #include <iostream>
 #include <vector>
-#include <fstream>
 #include <unistd.h>
 
 
@@ -51,7 +51,8 @@ int main(int argc, char **argv) {
 	rclcpp::ExecutorOptions options;
 	options.memory_strategy = executors.strat;
 	executors.strat->logger = create_logger();
-	executors.strat->is_f1tenth = true;
+	// chain 1 shares the timer of chain 0
+	bool is_f1tenth = true;
 	executors.executor = std::make_shared<timed_executor::MultiThreadTimedExecutor>(options, NumThreads, YieldBeforeExecute, std::chrono::nanoseconds(-1), "multi_test");
 	//executors.executor->set_use_priorities(true);
 
@@ -96,14 +97,11 @@ int main(int argc, char **argv) {
 	std::vector<std::vector<std::shared_ptr<rclcpp::Node>>> nodes;
 	std::vector<std::shared_ptr<PublisherNode>> publishers;
 	std::vector<std::shared_ptr<DummyWorker>> workers;
-	std::vector<std::vector<std::deque<uint> *> *> chain_deadlines_deque;
 
-	//std::deque<uint> *shared_chain_deadlines_deque = new std::deque<uint>();
+	//std::deque<uint64_t> *shared_chain_deadlines_deque = new std::deque<uint64_t>();
 	//node_time_logger logger = create_logger();
 	//timespec current_time;
-	timespec current_time;
-	clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-	uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+	uint64_t millis = simple_timer::now_ns() / 1000000;
 	PublisherNode::set_end_time(millis + 50000);
 	DummyWorker::set_end_time(millis + 50000);
 	uint64_t current_node_id = 0;
@@ -111,10 +109,6 @@ int main(int argc, char **argv) {
 		std::cout << "making chain" << std::to_string(chain_index) << std::endl;
 		std::shared_ptr<rclcpp::TimerBase> this_chain_timer_handle;
 
-		int max_chain_num = std::ceil(chain_deadlines[chain_index] / (double)chain_periods[chain_index]);
-		std::vector<std::deque<uint> *>* this_chain_deadlines_deque = new std::vector<std::deque<uint> *>(max_chain_num, nullptr);
-		for(uint index = 0; index < max_chain_num; ++index) (*this_chain_deadlines_deque)[index] = new std::deque<uint>();
-		//std::deque<uint> *this_chain_deadlines_deque = new std::deque<uint>();
 		nodes.push_back(std::vector<std::shared_ptr<rclcpp::Node>>());
 		
 		for (uint cb_index = 0; cb_index < chain_lengths[chain_index]; cb_index++) {
@@ -124,7 +118,7 @@ int main(int argc, char **argv) {
 				/*if (chain_index == 0) {
 					chain_deadlines_deque.push_back(shared_chain_deadlines_deque);
 				}*/
-				if (chain_index == 1 && executors.strat->is_f1tenth) {
+				if (chain_index == 1 && is_f1tenth) {
 					publisher_node = std::static_pointer_cast<PublisherNode>(nodes[0][0]);
 					this_chain_timer_handle = publisher_node->timer_;
 				}
@@ -140,11 +134,6 @@ int main(int argc, char **argv) {
 
 					executors.strat->set_first_in_chain(publisher_node->timer_->get_timer_handle());
 
-					//if (executors.strat->is_f1tenth && chain_index == 0)
-					//	executors.strat->assign_deadlines_queue(publisher_node->timer_->get_timer_handle(), shared_chain_deadlines_deque);
-					//else 
-						executors.strat->assign_deadlines_queue(publisher_node->timer_->get_timer_handle(), this_chain_deadlines_deque);
-
 					this_chain_timer_handle = publisher_node->timer_;
 					executors.strat->get_priority_settings(publisher_node->timer_->get_timer_handle())->timer_handle = this_chain_timer_handle;
 					executors.executor->add_node(publisher_node);
@@ -159,7 +148,7 @@ int main(int argc, char **argv) {
 			}
 			else {
 				std::shared_ptr<DummyWorker> sub_node;
-				if (chain_index == 1 && cb_index == 1 && executors.strat->is_f1tenth) {
+				if (chain_index == 1 && cb_index == 1 && is_f1tenth) {
 					sub_node = std::make_shared<DummyWorker>("chain_" + std::to_string(chain_index) + "_worker_" + std::to_string(cb_index), node_runtimes[current_node_id], chain_index, cb_index, true);
 				}
 				else {
@@ -174,7 +163,6 @@ int main(int argc, char **argv) {
 				workers.push_back(sub_node);
 				executors.strat->set_executable_deadline(sub_node->subscription_->get_subscription_handle(), chain_periods[chain_index], chain_deadlines[chain_index], SUBSCRIPTION, chain_index);
 				executors.executor->add_node(sub_node);
-				executors.strat->assign_deadlines_queue(sub_node->subscription_->get_subscription_handle(), this_chain_deadlines_deque);
 				if (cb_index == chain_lengths[chain_index] - 1) {
 					executors.strat->set_last_in_chain(sub_node->subscription_->get_subscription_handle());
 					executors.strat->get_priority_settings(sub_node->subscription_->get_subscription_handle())->timer_handle = this_chain_timer_handle;
@@ -183,18 +171,9 @@ int main(int argc, char **argv) {
 			}
 			current_node_id++;			
 		}
-		chain_deadlines_deque.push_back(this_chain_deadlines_deque);
-		/*
-		clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-		uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-		
-		log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + chain_deadlines[chain_index]));
-		log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis));
-		std::cout << "chain_index: " << chain_index << " " << "deadlines: " << millis + chain_deadlines[chain_index] << std::endl;
-		std::cout << " release: " << millis << std::endl;
-		chain_deadlines_deque[chain_index]->push_back(millis + chain_deadlines[chain_index]); 
-		*/
 	}
+	if (is_f1tenth)
+		executors.strat->fork_chain(0, 1);
 	std::cout << "initialized nodes" << std::endl;
 	
 	node_time_logger logger = create_logger();
@@ -210,21 +189,18 @@ int main(int argc, char **argv) {
 		else
 			this_chain_timer_handle = std::static_pointer_cast<PublisherNode>(nodes[chain_index][0])->timer_;
 		
-		clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-		uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-		uint64_t time_until_trigger = this_chain_timer_handle->time_until_trigger().count() / 1000000;
-		//log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + time_until_trigger + chain_deadlines[chain_index]));
-		//log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis + time_until_trigger));
+		uint64_t release = simple_timer::now_ns() + this_chain_timer_handle->time_until_trigger().count();
 		//std::cout << "chain_index: " << chain_index << " " << "deadlines: " << millis + time_until_trigger + chain_deadlines[chain_index] << std::endl;
 		//std::cout << " release: " << millis + time_until_trigger << std::endl;
 		//std::cout << " time_until_trigger: " << (this_chain_timer_handle->time_until_trigger().count() / 1000000) << std::endl;
 		//chain_deadlines_deque[chain_index + 1]->push_back(millis + chain_deadlines[chain_index]);
 		
-		executors.strat->assign_release_time(this_chain_timer_handle->get_timer_handle(), millis + time_until_trigger);
-		(*chain_deadlines_deque[chain_index])[0]->push_back(millis + time_until_trigger + chain_deadlines[chain_index]);
+		// a forked chain is released with the chain it branches off
+		if (!(is_f1tenth && chain_index == 1))
+			executors.strat->release_chain_job(chain_index, std::chrono::nanoseconds(release));
 		//chain_deadlines_deque[chain_index]->push_back(millis + time_until_trigger + chain_deadlines[chain_index]);
 		if (chain_index != 1)
-			log_entry(logger, std::to_string(chain_index) + " release_time: " + std::to_string(millis + time_until_trigger)); 
+			log_entry(logger, TRACE_RELEASE, chain_index, 0, release); 
 	}
 	
 
@@ -244,49 +220,14 @@ int main(int argc, char **argv) {
 	//int64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
 	//std::cout << "spin time: " << millis << std::endl;
 	//std::cout << "---------------" << std::endl;
+	std::string suffix = "";
+	simple_timer::TraceWriter trace_writer("experiments/multi_test" + std::to_string(NumThreads) + "c" + suffix + ".trace");
 	executors.executor->spin();
 	rclcpp::shutdown();
 	//executors.strat->print_all_handle_schedule_type();
 	std::cout << "rclcpp::shutdown()" << std::endl;
 	
-	std::ofstream output_file;
-	std::string suffix = "";
-	output_file.open("experiments/multi_test" + std::to_string(NumThreads) + "c" + suffix + ".txt");
-	std::vector<std::pair<std::string, u64>> combined_logs;
-
-	for (auto &publisher : publishers)
-  	{
-    	for (auto &log : *(publisher->logger_.recorded_times))
-    	{
-     		combined_logs.push_back(log);
-    	}
-  	}
-
-	for (auto &worker : workers)
-  	{
-    	for (auto &log : *(worker->logger_.recorded_times))
-    	{
-      		combined_logs.push_back(log);
-    	}
-  	}
-
-	//combined_logs.push_back(*(executors.strat->logger.recorded_times));
-	for (auto &log : *(executors.strat->logger.recorded_times)) 
-	{
-		combined_logs.push_back(log);
-	}
-
-	for (auto &log : *(logger.recorded_times)) 
-	{
-		combined_logs.push_back(log);
-	}
-	std::sort(combined_logs.begin(), combined_logs.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b)
-        { return a.second < b.second; });
-	for (auto p : combined_logs)
-  	{
-    	output_file << p.second << " " << p.first << std::endl;
-  	}
-  	output_file.close();
+	trace_writer.stop();
   	std::cout<<"data written"<<std::endl;
 	
 }
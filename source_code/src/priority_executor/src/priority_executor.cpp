@@ -14,6 +14,7 @@
 
 #include "priority_executor/priority_executor.hpp"
 #include "priority_executor/priority_memory_strategy.hpp"
+#include "priority_executor/cpu_topology.hpp"
 #include "rclcpp/any_executable.hpp"
 #include "rclcpp/scope_exit.hpp"
 #include "simple_timer/rt-sched.hpp"
@@ -23,12 +24,190 @@
 #include <bits/types/struct_sched_param.h>
 #include <memory>
 #include <sched.h>
+#include <cerrno>
+#include <cstring>
 #include <set>
+#include <sstream>
 using rclcpp::detail::MutexTwoPriorities;
 
 namespace timed_executor
 {
 
+  // a negative timeout waits forever
+  static std::chrono::nanoseconds
+  shorter_timeout(std::chrono::nanoseconds timeout1, std::chrono::nanoseconds timeout2)
+  {
+    if (timeout1 < std::chrono::nanoseconds::zero())
+    {
+      return timeout2;
+    }
+    if (timeout2 < std::chrono::nanoseconds::zero())
+    {
+      return timeout1;
+    }
+    return std::min(timeout1, timeout2);
+  }
+
+
+  // Dispatch events of an executable the strategy handed out, see PriorityMemoryStrategy::dispatch_started().
+  static void
+  report_dispatch(PriorityMemoryStrategy<> *strat, DispatchInfo &info, bool start)
+  {
+    if (strat == nullptr || info.id == NO_EXECUTABLE_ID)
+    {
+      return;
+    }
+    if (start)
+    {
+      strat->dispatch_started(info);
+    }
+    else
+    {
+      strat->dispatch_finished(info);
+    }
+  }
+
+  // Runs the registered chain successors of a finished executable on this thread.
+  // Their message is taken straight from the middleware, the wait set and a new
+  // dispatch decision are skipped; the strategy bookkeeping still runs, so the
+  // successor inherits the absolute deadline of the chain instance.
+  static void
+  run_chain_successors(
+      size_t id,
+      PriorityMemoryStrategy<> *strat,
+      std::mutex &strategy_mutex,
+      const rclcpp::memory_strategy::MemoryStrategy::WeakNodeList &weak_nodes,
+      rcl_guard_condition_t *interrupt_guard_condition)
+  {
+    if (!strat)
+    {
+      return;
+    }
+    while (true)
+    {
+      rclcpp::AnyExecutable successor;
+      size_t successor_id;
+      bool claimed;
+      {
+        std::lock_guard<std::mutex> guard(strategy_mutex);
+        successor_id = strat->get_chain_successor(id);
+        if (successor_id == NO_EXECUTABLE_ID)
+        {
+          return;
+        }
+        claimed = strat->claim_chain_successor(successor_id, successor, weak_nodes);
+      }
+      bool taken = false;
+      if (claimed)
+      {
+        rclcpp::SubscriptionBase::SharedPtr subscription = successor.subscription;
+        rclcpp::MessageInfo message_info;
+        message_info.get_rmw_message_info().from_intra_process = false;
+        std::shared_ptr<void> message;
+        // serialized and loaned messages keep going through the wait set
+        if (!subscription->is_serialized() && !subscription->can_loan_messages())
+        {
+          message = subscription->create_message();
+          try
+          {
+            taken = subscription->take_type_erased(message.get(), message_info);
+          }
+          catch (const rclcpp::exceptions::RCLError &rcl_error)
+          {
+            RCLCPP_ERROR(
+                rclcpp::get_logger("rclcpp"),
+                "executor taking a message from topic '%s' unexpectedly failed: %s",
+                subscription->get_topic_name(),
+                rcl_error.what());
+          }
+        }
+        DispatchInfo info;
+        {
+          std::lock_guard<std::mutex> guard(strategy_mutex);
+          strat->finish_chain_successor(successor_id, taken, &info);
+        }
+        if (taken)
+        {
+          strat->dispatch_started(info);
+          subscription->handle_message(message, message_info);
+          strat->dispatch_finished(info);
+        }
+        if (message)
+        {
+          subscription->return_message(message);
+        }
+      }
+      bool exclusive = successor.callback_group &&
+                       successor.callback_group->type() == rclcpp::CallbackGroupType::MutuallyExclusive;
+      if (successor.callback_group)
+      {
+        successor.callback_group->can_be_taken_from().store(true);
+        successor.callback_group.reset();
+      }
+      // a missed successor goes back into the wait set, a released group lets its siblings back in
+      if (!taken || exclusive)
+      {
+        rcl_ret_t ret = rcl_trigger_guard_condition(interrupt_guard_condition);
+        if (ret != RCL_RET_OK)
+        {
+          rclcpp::exceptions::throw_from_rcl_error(ret, "Failed to trigger guard condition after chain fusion");
+        }
+      }
+      if (!taken)
+      {
+        return;
+      }
+      id = successor_id;
+    }
+  }
+
+
+  // A persistent wait set is only resized when the number of entities changes.
+  // rcl_wait() nulls the entries that are not ready, also in its rmw arrays,
+  // so the handles are still added again before every wait.
+  static void
+  fill_wait_set(rcl_wait_set_t *wait_set, rclcpp::memory_strategy::MemoryStrategy::SharedPtr memory_strategy, bool persistent)
+  {
+    size_t subscriptions = memory_strategy->number_of_ready_subscriptions();
+    size_t guard_conditions = memory_strategy->number_of_guard_conditions();
+    size_t timers = memory_strategy->number_of_ready_timers();
+    size_t clients = memory_strategy->number_of_ready_clients();
+    size_t services = memory_strategy->number_of_ready_services();
+    size_t events = memory_strategy->number_of_ready_events();
+    bool same_size = wait_set->size_of_subscriptions == subscriptions &&
+                     wait_set->size_of_guard_conditions == guard_conditions &&
+                     wait_set->size_of_timers == timers &&
+                     wait_set->size_of_clients == clients &&
+                     wait_set->size_of_services == services &&
+                     wait_set->size_of_events == events;
+    rcl_ret_t ret;
+    if (!persistent || same_size)
+    {
+      // clear wait set
+      ret = rcl_wait_set_clear(wait_set);
+      if (ret != RCL_RET_OK)
+      {
+        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't clear wait set");
+      }
+    }
+
+    if (!persistent || !same_size)
+    {
+      // The size of waitables are accounted for in size of the other entities
+      ret = rcl_wait_set_resize(
+          wait_set, subscriptions, guard_conditions, timers, clients, services, events);
+      if (RCL_RET_OK != ret)
+      {
+        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't resize the wait set");
+      }
+    }
+
+    if (!memory_strategy->add_handles_to_wait_set(wait_set))
+    {
+      throw std::runtime_error("Couldn't fill wait set");
+    }
+  }
+
   TimedExecutor::TimedExecutor(const rclcpp::ExecutorOptions &options, std::string name)
       : rclcpp::Executor(options)
   {
@@ -45,6 +224,7 @@ namespace timed_executor
       throw std::runtime_error("spin() called while already spinning");
     }
     RCLCPP_SCOPE_EXIT(this->spinning.store(false););
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
     while (rclcpp::ok(this->context_) && spinning.load())
     {
       rclcpp::AnyExecutable any_executable;
@@ -53,8 +233,10 @@ namespace timed_executor
       // size_t ready = memory_strategy_->number_of_ready_subscriptions();
       // std::cout << "ready:" << ready << std::endl;
 
-      if (get_next_executable(any_executable))
+      DispatchInfo info;
+      if (get_next_executable(any_executable, std::chrono::nanoseconds(-1), &info))
       {
+        report_dispatch(strat, info, true);
         if (any_executable.subscription)
         {
           execute_subscription(any_executable);
@@ -63,6 +245,12 @@ namespace timed_executor
         {
           execute_any_executable(any_executable);
         }
+        report_dispatch(strat, info, false);
+        any_executable.callback_group.reset();
+        if (info.has_chain_successor)
+        {
+          run_chain_successors(info.id, strat, memory_strategy_mutex_, weak_nodes_, &interrupt_guard_condition_);
+        }
       }
     }
     std::cout << "shutdown" << std::endl;
@@ -167,14 +355,14 @@ namespace timed_executor
       subscription->return_message(message);
     }
   }
-  bool TimedExecutor::get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout)
+  bool TimedExecutor::get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout, DispatchInfo *info)
   {
     bool success = false;
     // Check to see if there are any subscriptions or timers needing service
     // TODO(wjwwood): improve run to run efficiency of this function
     // sched_yield();
-    wait_for_work(std::chrono::milliseconds(1));
-    success = get_next_ready_executable(any_executable);
+    wait_for_work(timeout);
+    success = get_next_ready_executable(any_executable, info);
     return success;
   }
 
@@ -182,12 +370,23 @@ namespace timed_executor
   void
   TimedExecutor::wait_for_work(std::chrono::nanoseconds timeout)
   {
+    // the legacy get_next_* lookups compact the handle lists, so this needs the priority path
+    bool persistent = use_persistent_wait_set_ && use_priorities;
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
     {
       std::unique_lock<std::mutex> lock(memory_strategy_mutex_);
 
       // Collect the subscriptions and timers to be waited on
-      memory_strategy_->clear_handles();
-      bool has_invalid_weak_nodes = memory_strategy_->collect_entities(weak_nodes_);
+      bool has_invalid_weak_nodes;
+      if (persistent)
+      {
+        has_invalid_weak_nodes = strat->refresh_handles(weak_nodes_);
+      }
+      else
+      {
+        memory_strategy_->clear_handles();
+        has_invalid_weak_nodes = memory_strategy_->collect_entities(weak_nodes_);
+      }
 
       // Clean up any invalid nodes, if they were detected
       if (has_invalid_weak_nodes)
@@ -209,27 +408,11 @@ namespace timed_executor
           }
         }
       }
-      // clear wait set
-      rcl_ret_t ret = rcl_wait_set_clear(&wait_set_);
-      if (ret != RCL_RET_OK)
+      fill_wait_set(&wait_set_, memory_strategy_, persistent);
+      if (strat)
       {
-        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't clear wait set");
-      }
-
-      // The size of waitables are accounted for in size of the other entities
-      ret = rcl_wait_set_resize(
-          &wait_set_, memory_strategy_->number_of_ready_subscriptions(),
-          memory_strategy_->number_of_guard_conditions(), memory_strategy_->number_of_ready_timers(),
-          memory_strategy_->number_of_ready_clients(), memory_strategy_->number_of_ready_services(),
-          memory_strategy_->number_of_ready_events());
-      if (RCL_RET_OK != ret)
-      {
-        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't resize the wait set");
-      }
-
-      if (!memory_strategy_->add_handles_to_wait_set(&wait_set_))
-      {
-        throw std::runtime_error("Couldn't fill wait set");
+        // sleep until the next timer release or chain deadline, not a fixed poll period
+        timeout = shorter_timeout(timeout, strat->get_next_wakeup_timeout());
       }
     }
     rcl_ret_t status =
@@ -248,16 +431,23 @@ namespace timed_executor
 
     // check the null handles in the wait set and remove them from the handles in memory strategy
     // for callback-based entities
-    memory_strategy_->remove_null_handles(&wait_set_);
+    if (persistent)
+    {
+      strat->mark_ready_handles(&wait_set_);
+    }
+    else
+    {
+      memory_strategy_->remove_null_handles(&wait_set_);
+    }
   }
   bool
-  TimedExecutor::get_next_ready_executable(rclcpp::AnyExecutable &any_executable)
+  TimedExecutor::get_next_ready_executable(rclcpp::AnyExecutable &any_executable, DispatchInfo *info)
   {
     bool success = false;
     if (use_priorities)
     {
-      std::shared_ptr<PriorityMemoryStrategy<>> strat = std::dynamic_pointer_cast<PriorityMemoryStrategy<>>(memory_strategy_);
-      strat->get_next_executable(any_executable, weak_nodes_);
+      auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+      strat->get_next_executable(any_executable, weak_nodes_, info);
       if (any_executable.timer || any_executable.subscription || any_executable.service || any_executable.client || any_executable.waitable)
       {
         success = true;
@@ -341,6 +531,11 @@ namespace timed_executor
     use_priorities = use_prio;
   }
 
+  void TimedExecutor::set_use_persistent_wait_set(bool use_persistent)
+  {
+    use_persistent_wait_set_ = use_persistent;
+  }
+
 
 
 //MultiThreadTimedExecutor implement 
@@ -468,12 +663,23 @@ namespace timed_executor
   void
   MultiThreadTimedExecutor::wait_for_work(std::chrono::nanoseconds timeout)
   {
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+    // other memory strategies keep the handle lists of rclcpp
+    bool persistent = use_persistent_wait_set_ && strat != nullptr;
     {
       std::unique_lock<std::mutex> lock(memory_strategy_mutex_);
 
       // Collect the subscriptions and timers to be waited on
-      memory_strategy_->clear_handles();
-      bool has_invalid_weak_nodes = memory_strategy_->collect_entities(weak_nodes_);
+      bool has_invalid_weak_nodes;
+      if (persistent)
+      {
+        has_invalid_weak_nodes = strat->refresh_handles(weak_nodes_);
+      }
+      else
+      {
+        memory_strategy_->clear_handles();
+        has_invalid_weak_nodes = memory_strategy_->collect_entities(weak_nodes_);
+      }
 
       // Clean up any invalid nodes, if they were detected
       if (has_invalid_weak_nodes)
@@ -495,27 +701,11 @@ namespace timed_executor
           }
         }
       }
-      // clear wait set
-      rcl_ret_t ret = rcl_wait_set_clear(&wait_set_);
-      if (ret != RCL_RET_OK)
-      {
-        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't clear wait set");
-      }
-
-      // The size of waitables are accounted for in size of the other entities
-      ret = rcl_wait_set_resize(
-          &wait_set_, memory_strategy_->number_of_ready_subscriptions(),
-          memory_strategy_->number_of_guard_conditions(), memory_strategy_->number_of_ready_timers(),
-          memory_strategy_->number_of_ready_clients(), memory_strategy_->number_of_ready_services(),
-          memory_strategy_->number_of_ready_events());
-      if (RCL_RET_OK != ret)
-      {
-        rclcpp::exceptions::throw_from_rcl_error(ret, "Couldn't resize the wait set");
-      }
-
-      if (!memory_strategy_->add_handles_to_wait_set(&wait_set_))
+      fill_wait_set(&wait_set_, memory_strategy_, persistent);
+      if (strat)
       {
-        throw std::runtime_error("Couldn't fill wait set");
+        // sleep until the next timer release or chain deadline, not a fixed poll period
+        timeout = shorter_timeout(timeout, strat->get_next_wakeup_timeout());
       }
     }
     rcl_ret_t status =
@@ -534,7 +724,16 @@ namespace timed_executor
 
     // check the null handles in the wait set and remove them from the handles in memory strategy
     // for callback-based entities
-    memory_strategy_->remove_null_handles(&wait_set_);
+    // chain fusion updates the strategy from the worker threads
+    std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+    if (persistent)
+    {
+      strat->mark_ready_handles(&wait_set_);
+    }
+    else
+    {
+      memory_strategy_->remove_null_handles(&wait_set_);
+    }
   }
   
   unsigned long long 
@@ -544,16 +743,109 @@ namespace timed_executor
   }
 
   void
-  MultiThreadTimedExecutor::run(size_t thread_id)
+  MultiThreadTimedExecutor::set_use_waiter_thread(bool use_waiter)
   {
+    use_waiter_thread_ = use_waiter;
+  }
 
-    //timespec current_time;
-    //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    //uint64_t millis1 = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  void
+  MultiThreadTimedExecutor::set_use_persistent_wait_set(bool use_persistent)
+  {
+    use_persistent_wait_set_ = use_persistent;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_partitioned(bool partitioned)
+  {
+    partitioned_ = partitioned;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_work_stealing(bool work_stealing)
+  {
+    work_stealing_ = work_stealing;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_use_concurrent_ready_queue(bool use_concurrent)
+  {
+    use_concurrent_ready_queue_ = use_concurrent;
+  }
+
+  void
+  MultiThreadTimedExecutor::assign_chain_to_worker(int chain_id, size_t thread_id)
+  {
+    if (thread_id >= number_of_threads_)
+    {
+      throw std::invalid_argument("assign_chain_to_worker: no such worker thread");
+    }
+    chain_workers_[chain_id] = thread_id;
+  }
+
+  size_t
+  MultiThreadTimedExecutor::get_chain_worker(int chain_id)
+  {
+    auto it = chain_workers_.find(chain_id);
+    if (it != chain_workers_.end())
+    {
+      return it->second;
+    }
+    return (size_t)std::abs(chain_id) % number_of_threads_;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_automatic_cpu_placement(bool automatic)
+  {
+    automatic_cpu_placement_ = automatic;
+  }
+
+  // explicit cpus win over the topology, without either thread i stays on cpu i
+  void
+  MultiThreadTimedExecutor::plan_worker_cpus()
+  {
+    worker_cpus_.clear();
+    const char *source;
+    if (!cpus.empty())
+    {
+      for (size_t i = 0; i < number_of_threads_; ++i)
+      {
+        worker_cpus_.push_back(cpus[i % cpus.size()]);
+      }
+      source = "explicit";
+    }
+    else if (automatic_cpu_placement_)
+    {
+      worker_cpus_ = choose_worker_cpus(number_of_threads_, read_cpu_topology());
+      source = "topology";
+    }
+    else
+    {
+      for (size_t i = 0; i < number_of_threads_; ++i)
+      {
+        worker_cpus_.push_back((int)i);
+      }
+      source = "thread id";
+    }
+    std::ostringstream mapping;
+    for (size_t i = 0; i < worker_cpus_.size(); ++i)
+    {
+      mapping << (i ? ", " : "") << i << "->" << worker_cpus_[i];
+    }
+    RCLCPP_INFO(rclcpp::get_logger("rclcpp"), "%s: worker cpus (%s): %s",
+                name.c_str(), source, mapping.str().c_str());
+  }
 
+  void
+  MultiThreadTimedExecutor::set_thread_affinity(size_t thread_id)
+  {
     cpu_set_t cpuset;
+    if (thread_id < planned_sched_params_.size() && planned_sched_params_[thread_id].policy == SCHED_DEADLINE)
+    {
+      // SCHED_DEADLINE is refused for a thread pinned narrower than its root domain
+      return;
+    }
     CPU_ZERO(&cpuset);
-    CPU_SET(thread_id, &cpuset);
+    CPU_SET(thread_id < worker_cpus_.size() ? worker_cpus_[thread_id] : thread_id, &cpuset);
     
     pthread_t current_thread = pthread_self();
     //std::cout << "current_thread_id: " << current_thread << std::endl;
@@ -563,18 +855,143 @@ namespace timed_executor
       std::cout << "problem setting cpu core" << std::endl;
       std::cout << strerror(result) << std::endl;
     }
+  }
+
+  void
+  MultiThreadTimedExecutor::set_thread_priority(const WorkerSchedParams &params)
+  {
+    if (params.policy == SCHED_DEADLINE)
+    {
+      struct sched_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.sched_policy = SCHED_DEADLINE;
+      attr.sched_runtime = params.runtime;
+      attr.sched_deadline = params.deadline;
+      attr.sched_period = params.period;
+      if (sched_setattr(0, &attr, 0))
+      {
+        RCLCPP_WARN(rclcpp::get_logger("rclcpp"), "%s: SCHED_DEADLINE reservation refused: %s",
+                    name.c_str(), strerror(errno));
+      }
+      return;
+    }
     sched_param sch_params;
-    sch_params.sched_priority = 99;
-    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params))
+    sch_params.sched_priority = params.priority;
+    int result = pthread_setschedparam(pthread_self(), params.policy, &sch_params);
+    if (result)
+    {
+      RCLCPP_WARN(rclcpp::get_logger("rclcpp"), "%s: spin_rt thread has an error: %s",
+                  name.c_str(), strerror(result));
+    }
+  }
+
+  void
+  MultiThreadTimedExecutor::set_worker_sched_params(const WorkerSchedParams &params)
+  {
+    default_sched_params_ = params;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_worker_sched_params(size_t thread_id, const WorkerSchedParams &params)
+  {
+    worker_sched_params_[thread_id] = params;
+  }
+
+  void
+  MultiThreadTimedExecutor::set_deadline_reservations(bool reserve, double headroom)
+  {
+    deadline_reservations_ = reserve;
+    reservation_headroom_ = headroom;
+  }
+
+  void
+  MultiThreadTimedExecutor::plan_worker_sched_params()
+  {
+    planned_sched_params_.assign(number_of_threads_, default_sched_params_);
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+    if (deadline_reservations_ && strat)
+    {
+      std::vector<double> utilization(number_of_threads_, 0);
+      std::vector<int64_t> period(number_of_threads_, 0);
+      for (auto &it : strat->get_chain_demands())
+      {
+        const ChainDemand &demand = it.second;
+        if (demand.period <= 0 || demand.runtime <= 0)
+        {
+          continue;
+        }
+        for (size_t i = 0; i < number_of_threads_; ++i)
+        {
+          if (partitioned_ && get_chain_worker(it.first) != i)
+          {
+            continue;
+          }
+          utilization[i] += (double)demand.runtime / demand.period / (partitioned_ ? 1 : number_of_threads_);
+          if (period[i] == 0 || demand.period < period[i])
+          {
+            period[i] = demand.period;
+          }
+        }
+      }
+      for (size_t i = 0; i < number_of_threads_; ++i)
+      {
+        if (period[i] == 0)
+        {
+          // no chain with a known runtime, nothing to size the reservation from
+          continue;
+        }
+        WorkerSchedParams &params = planned_sched_params_[i];
+        params.policy = SCHED_DEADLINE;
+        params.period = period[i];
+        params.deadline = params.period;
+        params.runtime = (uint64_t)(std::min(1.0, utilization[i] * reservation_headroom_) * params.period);
+      }
+    }
+    for (auto &it : worker_sched_params_)
+    {
+      if (it.first < number_of_threads_)
+      {
+        planned_sched_params_[it.first] = it.second;
+      }
+    }
+
+    std::ostringstream policies;
+    for (size_t i = 0; i < planned_sched_params_.size(); ++i)
     {
-      RCLCPP_INFO(rclcpp::get_logger("rclcpp"), "spin_rt thread has an error.");
+      const WorkerSchedParams &params = planned_sched_params_[i];
+      policies << (i ? ", " : "") << i << "->";
+      if (params.policy == SCHED_DEADLINE)
+      {
+        policies << "deadline " << params.runtime / 1000 << "/" << params.deadline / 1000 << "/" << params.period / 1000 << "us";
+      }
+      else
+      {
+        policies << (params.policy == SCHED_RR ? "rr " : params.policy == SCHED_FIFO ? "fifo " : "other ") << params.priority;
+      }
     }
+    RCLCPP_INFO(rclcpp::get_logger("rclcpp"), "%s: worker policies: %s",
+                name.c_str(), policies.str().c_str());
+  }
+
+  void
+  MultiThreadTimedExecutor::run(size_t thread_id)
+  {
+
+    //timespec current_time;
+    //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
+    //uint64_t millis1 = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+
+    set_thread_affinity(thread_id);
+    set_thread_priority(planned_sched_params_[thread_id]);
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
     //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
     //uint64_t millis2 = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
     //std::cout << "time_gap3:" << millis2 - millis1 << std::endl;
     //timespec current_time;
     while (rclcpp::ok(this->context_) && spinning.load()) {
       rclcpp::AnyExecutable any_executable;
+      DispatchInfo info;
       {
         //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
         //uint64_t millis1 = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
@@ -583,7 +1000,7 @@ namespace timed_executor
         if (!rclcpp::ok(this->context_) || !spinning.load()) {
           return;
         }
-        if (!get_next_executable(any_executable)) {
+        if (!get_next_executable(any_executable, std::chrono::nanoseconds(-1), &info)) {
           continue;
         }
         //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
@@ -607,14 +1024,17 @@ namespace timed_executor
         std::this_thread::yield();
       }
 
+      report_dispatch(strat, info, true);
       if (any_executable.subscription)
       {
         execute_subscription(any_executable);
+        notify_group_released(any_executable);
       }
       else
       {
         execute_any_executable(any_executable);
       }
+      report_dispatch(strat, info, false);
       if (any_executable.timer) {
         auto high_priority_wait_mutex = wait_mutex_.get_high_priority_lockable();
         std::lock_guard<MutexTwoPriorities::HighPriorityLockable> wait_lock(high_priority_wait_mutex);
@@ -627,6 +1047,10 @@ namespace timed_executor
       // Clear the callback_group to prevent the AnyExecutable destructor from
       // resetting the callback group `can_be_taken_from`
       any_executable.callback_group.reset();
+      if (info.has_chain_successor)
+      {
+        run_chain_successors(info.id, strat, memory_strategy_mutex_, weak_nodes_, &interrupt_guard_condition_);
+      }
     }
   }
 
@@ -640,8 +1064,61 @@ namespace timed_executor
       throw std::runtime_error("spin() called while already spinning");
     }
     RCLCPP_SCOPE_EXIT(this->spinning.store(false); );
+    plan_worker_cpus();
+    plan_worker_sched_params();
     std::vector<std::thread> threads;
     size_t thread_id = 0;
+    if (use_waiter_thread_ || partitioned_)
+    {
+      // global EDF shares one queue between all workers, partitioned EDF gives each its own
+      ready_queues_.clear();
+      size_t number_of_queues = partitioned_ ? number_of_threads_ : 1;
+      for (size_t i = 0; i < number_of_queues; ++i)
+      {
+        ready_queues_.emplace_back(new ReadyQueue());
+      }
+      if (use_concurrent_ready_queue_ && !partitioned_)
+      {
+        concurrent_queue_.reset(new MultiQueue<ReadyExecutable>(2 * number_of_threads_));
+        concurrent_queue_closed_ = false;
+      }
+      for (; thread_id < number_of_threads_; ++thread_id) {
+        auto func = std::bind(&MultiThreadTimedExecutor::run_worker, this, thread_id);
+        threads.emplace_back(func);
+      }
+      run_waiter();
+      for (auto & thread : threads) {
+        thread.join();
+      }
+      // drop whatever was released but not run, their groups are reset on destruction
+      auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+      std::lock_guard<std::mutex> completed_lock(completed_mutex_);
+      for (auto &ready_queue : ready_queues_)
+      {
+        while (!ready_queue->queue.empty())
+        {
+          completed_.push_back(ready_queue->queue.top().info.id);
+          ready_queue->queue.pop();
+        }
+      }
+      ready_queues_.clear();
+      if (concurrent_queue_)
+      {
+        ReadyExecutable ready;
+        while (concurrent_queue_->try_pop(ready))
+        {
+          completed_.push_back(ready.info.id);
+        }
+        concurrent_queue_.reset();
+      }
+      std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+      for (size_t id : completed_)
+      {
+        strat->set_excluded(id, false);
+      }
+      completed_.clear();
+      return;
+    }
     {
       auto low_priority_wait_mutex = wait_mutex_.get_low_priority_lockable();
       std::lock_guard<MutexTwoPriorities::LowPriorityLockable> wait_lock(low_priority_wait_mutex);
@@ -661,22 +1138,316 @@ namespace timed_executor
 
   
   bool 
-  MultiThreadTimedExecutor::get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout)
+  MultiThreadTimedExecutor::get_next_executable(rclcpp::AnyExecutable &any_executable, std::chrono::nanoseconds timeout, DispatchInfo *info)
   {
     bool success = false;
     // Check to see if there are any subscriptions or timers needing service
     // TODO(wjwwood): improve run to run efficiency of this function
     // sched_yield();
-    wait_for_work(std::chrono::milliseconds(1));
-    success = get_next_ready_executable(any_executable);
+    wait_for_work(shorter_timeout(timeout, next_exec_timeout_));
+    success = get_next_ready_executable(any_executable, info);
     return success;
   }
+
+  void
+  MultiThreadTimedExecutor::run_waiter()
+  {
+    // the waiter keeps a fixed priority, a reservation is sized for the chains' work only
+    set_thread_priority(default_sched_params_.policy == SCHED_DEADLINE ? WorkerSchedParams() : default_sched_params_);
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+    // workers running chain successors remove from the ready heap as well
+    auto has_ready = [&]()
+    {
+      std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+      return strat->number_of_ready_executables() > 0;
+    };
+    while (rclcpp::ok(this->context_) && spinning.load())
+    {
+      {
+        // workers wake us through the interrupt guard condition after they
+        // finish, their executables can be waited on again
+        std::lock_guard<std::mutex> completed_lock(completed_mutex_);
+        std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+        for (size_t id : completed_)
+        {
+          strat->set_excluded(id, false);
+        }
+        completed_.clear();
+      }
+      wait_for_work(next_exec_timeout_);
+      while (has_ready())
+      {
+        auto any_executable = std::make_shared<rclcpp::AnyExecutable>();
+        DispatchInfo info;
+        if (!get_next_ready_executable(*any_executable, &info))
+        {
+          continue;
+        }
+        ReadyExecutable ready;
+        ready.executable = any_executable;
+        ready.info = info;
+        ready.sequence = ready_sequence_++;
+        // a released job stays ready in rcl until a worker takes it, keep it out
+        // of the wait set so it is not released (and its chain advanced) twice
+        {
+          std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+          strat->set_excluded(ready.info.id, true);
+        }
+        if (concurrent_queue_)
+        {
+          concurrent_queue_->push(ready.info.sort_key, ready);
+          if (sleeping_workers_.load() > 0)
+          {
+            {
+              // a worker between its emptiness check and going to sleep holds the lock
+              std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+            }
+            idle_cv_.notify_one();
+          }
+          continue;
+        }
+        size_t worker = partitioned_ ? get_chain_worker(info.chain_id) : 0;
+        ReadyQueue &ready_queue = *ready_queues_[worker];
+        {
+          std::lock_guard<SpinLock> ready_lock(ready_queue.lock);
+          ready_queue.queue.push(ready);
+          ready_queue.size++;
+        }
+        ready_queue.cv.notify_one();
+        if (is_work_stealing() && !ready_queue.idle.load())
+        {
+          // the owner is busy, let an idle peer take it instead
+          wake_idle_worker(worker);
+        }
+      }
+    }
+    for (auto &ready_queue : ready_queues_)
+    {
+      {
+        std::lock_guard<SpinLock> ready_lock(ready_queue->lock);
+        ready_queue->closed = true;
+      }
+      ready_queue->cv.notify_all();
+    }
+    {
+      std::lock_guard<std::mutex> idle_lock(idle_mutex_);
+      concurrent_queue_closed_ = true;
+    }
+    idle_cv_.notify_all();
+  }
+
+  void
+  MultiThreadTimedExecutor::run_worker(size_t thread_id)
+  {
+    set_thread_affinity(thread_id);
+    set_thread_priority(planned_sched_params_[thread_id]);
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+    while (true)
+    {
+      ReadyExecutable ready;
+      if (!take_ready_executable(thread_id, ready))
+      {
+        return;
+      }
+      if (yield_before_execute_) {
+        std::this_thread::yield();
+      }
+
+      rclcpp::AnyExecutable &any_executable = *ready.executable;
+      report_dispatch(strat, ready.info, true);
+      if (any_executable.subscription)
+      {
+        execute_subscription(any_executable);
+      }
+      else
+      {
+        execute_any_executable(any_executable);
+      }
+      report_dispatch(strat, ready.info, false);
+      // Clear the callback_group to prevent the AnyExecutable destructor from
+      // resetting the callback group `can_be_taken_from`
+      any_executable.callback_group.reset();
+
+      {
+        std::lock_guard<std::mutex> completed_lock(completed_mutex_);
+        completed_.push_back(ready.info.id);
+      }
+      rcl_ret_t ret = rcl_trigger_guard_condition(&interrupt_guard_condition_);
+      if (ret != RCL_RET_OK)
+      {
+        rclcpp::exceptions::throw_from_rcl_error(ret, "Failed to trigger guard condition from run_worker");
+      }
+      if (ready.info.has_chain_successor)
+      {
+        run_chain_successors(ready.info.id, strat, memory_strategy_mutex_, weak_nodes_, &interrupt_guard_condition_);
+      }
+    }
+  }
+
+  // execute_any_executable() wakes the thread blocked in rcl_wait itself,
+  // execute_subscription() does not; without this the siblings of a mutually
+  // exclusive group sit out of the wait set until the next timeout
+  void
+  MultiThreadTimedExecutor::notify_group_released(const rclcpp::AnyExecutable &any_executable)
+  {
+    if (!any_executable.callback_group ||
+        any_executable.callback_group->type() != rclcpp::CallbackGroupType::MutuallyExclusive)
+    {
+      return;
+    }
+    any_executable.callback_group->can_be_taken_from().store(true);
+    rcl_ret_t ret = rcl_trigger_guard_condition(&interrupt_guard_condition_);
+    if (ret != RCL_RET_OK)
+    {
+      rclcpp::exceptions::throw_from_rcl_error(ret, "Failed to trigger guard condition on callback group release");
+    }
+  }
+
+  bool
+  MultiThreadTimedExecutor::is_work_stealing()
+  {
+    return work_stealing_ && partitioned_ && ready_queues_.size() > 1;
+  }
+
+  // blocks until the worker's own queue or, when stealing, a peer's queue has a job
+  bool
+  MultiThreadTimedExecutor::take_concurrent_ready_executable(ReadyExecutable &ready)
+  {
+    while (true)
+    {
+      if (concurrent_queue_->try_pop(ready))
+      {
+        return true;
+      }
+      std::unique_lock<std::mutex> idle_lock(idle_mutex_);
+      sleeping_workers_++;
+      idle_cv_.wait(idle_lock, [this]()
+                    { return !concurrent_queue_->empty() || concurrent_queue_closed_; });
+      sleeping_workers_--;
+      if (concurrent_queue_closed_)
+      {
+        return false;
+      }
+    }
+  }
+
+  bool
+  MultiThreadTimedExecutor::take_ready_executable(size_t thread_id, ReadyExecutable &ready)
+  {
+    if (concurrent_queue_)
+    {
+      return take_concurrent_ready_executable(ready);
+    }
+    ReadyQueue &ready_queue = *ready_queues_[partitioned_ ? thread_id : 0];
+    bool stealing = is_work_stealing();
+    while (true)
+    {
+      {
+        std::unique_lock<SpinLock> ready_lock(ready_queue.lock);
+        ready_queue.idle = true;
+        ready_queue.cv.wait(ready_lock, [&]()
+                            { return !ready_queue.queue.empty() || ready_queue.closed ||
+                                     (stealing && has_stealable_work(thread_id)); });
+        ready_queue.idle = false;
+        if (ready_queue.closed)
+        {
+          return false;
+        }
+        if (!ready_queue.queue.empty())
+        {
+          ready = ready_queue.queue.top();
+          ready_queue.queue.pop();
+          ready_queue.size--;
+          return true;
+        }
+      }
+      if (steal_ready_executable(thread_id, ready))
+      {
+        return true;
+      }
+    }
+  }
+
   bool
-  MultiThreadTimedExecutor::get_next_ready_executable(rclcpp::AnyExecutable &any_executable)
+  MultiThreadTimedExecutor::has_stealable_work(size_t thread_id)
+  {
+    for (size_t i = 0; i < ready_queues_.size(); ++i)
+    {
+      if (i != thread_id && ready_queues_[i]->size.load() > 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // takes the earliest deadline job among the peers' queues, only ever holding one queue lock
+  bool
+  MultiThreadTimedExecutor::steal_ready_executable(size_t thread_id, ReadyExecutable &ready)
+  {
+    ReadyExecutableComparator later;
+    ReadyQueue *victim = nullptr;
+    ReadyExecutable earliest;
+    for (size_t i = 0; i < ready_queues_.size(); ++i)
+    {
+      if (i == thread_id || ready_queues_[i]->size.load() == 0)
+      {
+        continue;
+      }
+      std::lock_guard<SpinLock> ready_lock(ready_queues_[i]->lock);
+      if (ready_queues_[i]->queue.empty())
+      {
+        continue;
+      }
+      if (victim == nullptr || later(earliest, ready_queues_[i]->queue.top()))
+      {
+        victim = ready_queues_[i].get();
+        earliest = ready_queues_[i]->queue.top();
+      }
+    }
+    if (victim == nullptr)
+    {
+      return false;
+    }
+    std::lock_guard<SpinLock> ready_lock(victim->lock);
+    if (victim->queue.empty())
+    {
+      return false;
+    }
+    ready = victim->queue.top();
+    victim->queue.pop();
+    victim->size--;
+    return true;
+  }
+
+  void
+  MultiThreadTimedExecutor::wake_idle_worker(size_t busy_worker)
+  {
+    for (size_t i = 0; i < ready_queues_.size(); ++i)
+    {
+      ReadyQueue &ready_queue = *ready_queues_[i];
+      if (i == busy_worker || !ready_queue.idle.load())
+      {
+        continue;
+      }
+      {
+        // a worker between its predicate check and going to sleep holds its lock
+        std::lock_guard<SpinLock> ready_lock(ready_queue.lock);
+      }
+      ready_queue.cv.notify_one();
+      return;
+    }
+  }
+
+  bool
+  MultiThreadTimedExecutor::get_next_ready_executable(rclcpp::AnyExecutable &any_executable, DispatchInfo *info)
   {
     bool success = false;
-    std::shared_ptr<PriorityMemoryStrategy<>> strat = std::dynamic_pointer_cast<PriorityMemoryStrategy<>>(memory_strategy_);
-    strat->get_next_executable(any_executable, weak_nodes_);
+    auto strat = dynamic_cast<PriorityMemoryStrategy<> *>(memory_strategy_.get());
+    {
+      std::lock_guard<std::mutex> guard(memory_strategy_mutex_);
+      strat->get_next_executable(any_executable, weak_nodes_, info);
+    }
     if (any_executable.timer || any_executable.subscription || any_executable.service || any_executable.client || any_executable.waitable)
     {
       success = true;
@@ -0,0 +1,108 @@
+// Compares the global ready heap under one mutex, as all_executables_ is used
+// today, with the MultiQueue. Every thread alternates between releasing a job
+// with a random deadline and taking the earliest one.
+#include "priority_executor/ready_queue.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+using timed_executor::MultiQueue;
+
+struct Job
+{
+  uint64_t deadline;
+  uint64_t id;
+};
+
+class HeapQueue
+{
+public:
+  void push(uint64_t key, Job job)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    heap_.push(Entry{key, job});
+  }
+  bool try_pop(Job &job)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (heap_.empty())
+    {
+      return false;
+    }
+    job = heap_.top().job;
+    heap_.pop();
+    return true;
+  }
+
+private:
+  struct Entry
+  {
+    uint64_t key;
+    Job job;
+    bool operator<(const Entry &other) const
+    {
+      return key > other.key;
+    }
+  };
+  std::mutex mutex_;
+  std::priority_queue<Entry> heap_;
+};
+
+template <typename Queue>
+double run(Queue &queue, size_t number_of_threads, size_t operations)
+{
+  // start from a backlog so pops rarely find the queue empty
+  std::mt19937_64 engine(42);
+  for (size_t i = 0; i < 1024; ++i)
+  {
+    uint64_t deadline = engine() % 1000000;
+    queue.push(deadline, Job{deadline, i});
+  }
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < number_of_threads; ++t)
+  {
+    threads.emplace_back([&queue, &go, t, operations]()
+                         {
+      std::mt19937_64 engine(t);
+      while (!go.load())
+      {
+      }
+      Job job;
+      for (size_t i = 0; i < operations; ++i)
+      {
+        uint64_t deadline = engine() % 1000000;
+        queue.push(deadline, Job{deadline, i});
+        queue.try_pop(job);
+      } });
+  }
+  auto start = std::chrono::steady_clock::now();
+  go = true;
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return 2.0 * number_of_threads * operations / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+  size_t operations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  std::cout << "threads,heap_mops,multiqueue_mops" << std::endl;
+  for (size_t number_of_threads : {4, 8, 16})
+  {
+    HeapQueue heap;
+    MultiQueue<Job> multi_queue(2 * number_of_threads);
+    double heap_mops = run(heap, number_of_threads, operations);
+    double multi_queue_mops = run(multi_queue, number_of_threads, operations);
+    std::cout << number_of_threads << "," << heap_mops << "," << multi_queue_mops << std::endl;
+  }
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "priority_executor/test_nodes.hpp"
 #include "priority_executor/primes_workload.hpp"
 #include "simple_timer/rt-sched.hpp"
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <thread>
@@ -8,7 +9,18 @@
 using namespace std::chrono_literals;
 using std::placeholders::_1;
 
+// the publish count in "MESSAGE<count>", the instance of the chain the message belongs to
+static uint64_t message_number(const std::string &data)
+{
+  return data.size() > 7 ? std::strtoull(data.c_str() + 7, nullptr, 10) : 0;
+}
+
 PublisherNode::PublisherNode(std::string publish_topic, int chain, int period, double runtime)
+    : PublisherNode(publish_topic, chain, std::chrono::milliseconds(period), runtime)
+{
+}
+
+PublisherNode::PublisherNode(std::string publish_topic, int chain, std::chrono::nanoseconds period, double runtime)
     : Node("PublisherNode_" + publish_topic), count_(0)
 {
   logger_ = create_logger();
@@ -30,11 +42,7 @@ PublisherNode::PublisherNode(std::string publish_topic, int chain, int period, d
       return;
     }
     */
-    timespec current_time;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-    uint64_t time_until_trigger = timer_->time_until_trigger().count() / 1000000;
-    this->logger_.recorded_times->push_back(std::make_pair(std::to_string(this->chain) + " release_time: " + std::to_string(millis + time_until_trigger), get_time_us()));
+    log_entry(this->logger_, TRACE_RELEASE, this->chain, this->count_, simple_timer::now_ns() + timer_->time_until_trigger().count());
     //std::cout << "chain_id: " << this->chain << " time_until_trigger: " << time_until_trigger << " release_time: " << millis + time_until_trigger << std::endl;
     //std::cout << "chain_id: " << this->chain << " current_time: " << millis << std::endl;
     //auto thread_id = std::this_thread::get_id();
@@ -44,16 +52,14 @@ PublisherNode::PublisherNode(std::string publish_topic, int chain, int period, d
     
     //this->logger_.recorded_times->push_back(std::make_pair(std::string(this->get_name()) + "_publish_" + std::to_string(this->count_) + "_thread_id: " + thread_id_str, get_time_us()));
     //this->logger_.recorded_times->push_back(std::make_pair("chain_" + std::to_string(this->chain) + "_worker_0_recv_MESSAGE" + std::to_string(this->count_) + "_thread_id: " + thread_id_str, get_time_us()));
-    clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+    uint64_t millis = simple_timer::now_ns() / 1000000;
     if (millis > end_time) {
       rclcpp::shutdown();
       return;
     }
     double result = nth_prime_silly(100000, this->runtime);
     
-    clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+    millis = simple_timer::now_ns() / 1000000;
     if (millis > end_time) {
       rclcpp::shutdown();
       return;
@@ -70,7 +76,7 @@ PublisherNode::PublisherNode(std::string publish_topic, int chain, int period, d
   //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
   //uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
   //std::cout << "timer create before: " << millis << std::endl; 
-  timer_ = this->create_wall_timer(std::chrono::milliseconds(period), timer_callback);
+  timer_ = this->create_wall_timer(period, timer_callback);
   //timer_ = this->create_timer(std::chrono::milliseconds(period), timer_callback);
   //clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
   //millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
@@ -113,17 +119,14 @@ void DummyWorker::topic_callback(const std_msgs::msg::String::SharedPtr msg) con
   //std::string thread_id_str = ss.str();
   //this->logger_.recorded_times->push_back(std::make_pair(std::string(this->get_name()) + "_recv_" + msg->data + "_thread_id: " + thread_id_str, get_time_us()));
   //std::cout << this->chain << " working" <<std::endl;
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > end_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, runtime);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > end_time) {
       rclcpp::shutdown();
       return;
@@ -131,9 +134,7 @@ void DummyWorker::topic_callback(const std_msgs::msg::String::SharedPtr msg) con
   //std::cout << "is_last_in_chain: " << is_last_in_chain << std::endl;
   if (is_last_in_chain) {
     //std::cout << this->chain << " is_last_in_chain" << std::endl;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-    uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-    this->logger_.recorded_times->push_back(std::make_pair(std::to_string(this->chain) + " completed_time: " + std::to_string(millis), get_time_us()));
+    log_entry(this->logger_, TRACE_COMPLETE, this->chain, message_number(msg->data), simple_timer::now_ns());
   }
   
   //this->logger_.recorded_times->push_back(std::make_pair(std::string(this->get_name()) + "_processed_" + msg->data + "_thread_id: " + thread_id_str, get_time_us()));
@@ -187,17 +188,14 @@ MuExWorker::MuExWorker(const std::string &name) : Node(name) {
 
 void MuExWorker::topic_callback31(const std_msgs::msg::String::SharedPtr msg) const {
 
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, 8.0);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
@@ -220,17 +218,14 @@ void MuExWorker::topic_callback31(const std_msgs::msg::String::SharedPtr msg) co
 
 void MuExWorker::topic_callback32(const std_msgs::msg::String::SharedPtr msg) const {
 
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, 14.0);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
@@ -238,9 +233,7 @@ void MuExWorker::topic_callback32(const std_msgs::msg::String::SharedPtr msg) co
   //std::cout << "is_last_in_chain: " << is_last_in_chain << std::endl;
   //if (is_last_in_chain) {
   //  //std::cout << this->chain << " is_last_in_chain" << std::endl;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-  this->logger_.recorded_times->push_back(std::make_pair(std::to_string(3) + " completed_time: " + std::to_string(millis), get_time_us()));
+  log_entry(this->logger_, TRACE_COMPLETE, 3, message_number(msg->data), simple_timer::now_ns());
   //}
   
   //this->logger_.recorded_times->push_back(std::make_pair(std::string(this->get_name()) + "_processed_" + msg->data + "_thread_id: " + thread_id_str, get_time_us()));
@@ -254,17 +247,14 @@ void MuExWorker::topic_callback32(const std_msgs::msg::String::SharedPtr msg) co
 
 void MuExWorker::topic_callback41(const std_msgs::msg::String::SharedPtr msg) const {
 
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, 11.0);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
@@ -287,17 +277,14 @@ void MuExWorker::topic_callback41(const std_msgs::msg::String::SharedPtr msg) co
 
 void MuExWorker::topic_callback42(const std_msgs::msg::String::SharedPtr msg) const {
 
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, 8.0);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
@@ -320,17 +307,14 @@ void MuExWorker::topic_callback42(const std_msgs::msg::String::SharedPtr msg) co
 
 void MuExWorker::topic_callback43(const std_msgs::msg::String::SharedPtr msg) const {
 
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  uint64_t millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
   }
   double result = nth_prime_silly(100000, 8.0);
 
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  millis = simple_timer::now_ns() / 1000000;
   if (millis > ed_time) {
       rclcpp::shutdown();
       return;
@@ -338,9 +322,7 @@ void MuExWorker::topic_callback43(const std_msgs::msg::String::SharedPtr msg) co
   //std::cout << "is_last_in_chain: " << is_last_in_chain << std::endl;
   //if (is_last_in_chain) {
   //  //std::cout << this->chain << " is_last_in_chain" << std::endl;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
-  this->logger_.recorded_times->push_back(std::make_pair(std::to_string(4) + " completed_time: " + std::to_string(millis), get_time_us()));
+  log_entry(this->logger_, TRACE_COMPLETE, 4, message_number(msg->data), simple_timer::now_ns());
   //}
   
   //this->logger_.recorded_times->push_back(std::make_pair(std::string(this->get_name()) + "_processed_" + msg->data + "_thread_id: " + thread_id_str, get_time_us()));
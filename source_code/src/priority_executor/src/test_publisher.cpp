@@ -3,13 +3,17 @@
 #include "priority_executor/priority_memory_strategy.hpp"
 #include "priority_executor/test_nodes.hpp"
 #include <string>
-#include <fstream>
 #include "simple_timer/rt-sched.hpp"
+#include "simple_timer/trace_writer.hpp"
 #include "priority_executor/default_executor.hpp"
 #include <unistd.h>
 
 // clock_t times(struct tms *buf);
 
+uint64_t PublisherNode::end_time;
+uint64_t DummyWorker::end_time;
+uint64_t MuExWorker::ed_time;
+
 std::vector<int64_t> get_parameter_array(std::shared_ptr<rclcpp::Node> node, std::string name, std::vector<int64_t> default_val)
 {
   rclcpp::Parameter param_result(name, default_val);
@@ -135,13 +139,14 @@ int main(int argc, char **argv)
   // stock ROS executor
   // rclcpp::executors::SingleThreadedExecutor sub1_executor;
   std::vector<std::shared_ptr<DummyWorker>> workers;
-  std::vector<std::deque<uint> *> chain_deadlines_deque;
   std::vector<std::shared_ptr<PublisherNode>> timers;
+  uint64_t millis = simple_timer::now_ns() / 1000000;
+  PublisherNode::set_end_time(millis + 50000);
+  DummyWorker::set_end_time(millis + 50000);
   // TODO: make the chain layout configurable via rosparam
   for (uint chain_index = 0; chain_index < NUM_CHAINS; chain_index++)
   {
     std::shared_ptr<rclcpp::TimerBase> this_chain_timer_handle;
-    std::deque<uint> *this_chain_deadlines_deque = new std::deque<uint>();
     for (int cb_index = 0; cb_index < chain_lengths[chain_index]; cb_index++)
     {
       int total_prio = 0;
@@ -168,7 +173,7 @@ int main(int argc, char **argv)
         pubnode->count_max = COUNT_MAX;
         if (schedule_type == DEADLINE)
         {
-          strat->set_executable_deadline(pubnode->timer_->get_timer_handle(), chain_deadlines[chain_index], TIMER, chain_index);
+          strat->set_executable_deadline(pubnode->timer_->get_timer_handle(), std::chrono::milliseconds(chain_periods[chain_index]), std::chrono::milliseconds(chain_deadlines[chain_index]), TIMER, chain_index);
         }
         else if (schedule_type == CHAIN_AWARE_PRIORITY)
         {
@@ -178,7 +183,6 @@ int main(int argc, char **argv)
         if (schedule_type != DEFAULT)
         {
           strat->set_first_in_chain(pubnode->timer_->get_timer_handle());
-          strat->assign_deadlines_queue(pubnode->timer_->get_timer_handle(), this_chain_deadlines_deque);
           strat->get_priority_settings(pubnode->timer_->get_timer_handle())->timer_handle = pubnode->timer_;
           this_chain_timer_handle = pubnode->timer_;
         }
@@ -209,7 +213,7 @@ int main(int argc, char **argv)
         }
         if (schedule_type == DEADLINE)
         {
-          strat->set_executable_deadline(sub1node->subscription_->get_subscription_handle(), chain_deadlines[chain_index], SUBSCRIPTION, chain_index);
+          strat->set_executable_deadline(sub1node->subscription_->get_subscription_handle(), std::chrono::milliseconds(chain_periods[chain_index]), std::chrono::milliseconds(chain_deadlines[chain_index]), SUBSCRIPTION, chain_index);
         }
         else if (schedule_type == CHAIN_AWARE_PRIORITY)
         {
@@ -218,7 +222,6 @@ int main(int argc, char **argv)
         }
         if (schedule_type != DEFAULT)
         {
-          strat->assign_deadlines_queue(sub1node->subscription_->get_subscription_handle(), this_chain_deadlines_deque);
           if (cb_index == chain_lengths[chain_index] - 1)
           {
             strat->set_last_in_chain(sub1node->subscription_->get_subscription_handle());
@@ -228,21 +231,21 @@ int main(int argc, char **argv)
         workers.push_back(sub1node);
       }
     }
-    chain_deadlines_deque.push_back(this_chain_deadlines_deque);
   }
   std::cout << "initialized nodes" << std::endl;
   node_time_logger logger = create_logger();
-  // initialize first deadlines
-  timespec current_time;
-  clock_gettime(CLOCK_MONOTONIC_RAW, &current_time);
-  uint64_t millis = (current_time.tv_sec * (uint64_t)1000) + (current_time.tv_nsec / 1000000);
+  // release the first instances with the first timer firings
   for (uint chain_index = 0; chain_index < NUM_CHAINS; chain_index++)
   {
-    log_entry(logger, "deadline_" + std::to_string(chain_index) + "_" + std::to_string(millis + chain_deadlines[chain_index]));
-    log_entry(logger, "timer_" + std::to_string(chain_index) + "_release_" + std::to_string(millis));
-    chain_deadlines_deque[chain_index]->push_back(millis + chain_deadlines[chain_index]);
-    // chain_deadlines_deque[chain_index]->push_back(0);
+    uint64_t release = simple_timer::now_ns() + timers[chain_index]->timer_->time_until_trigger().count();
+    if (schedule_type == DEADLINE)
+    {
+      strat->release_chain_job(chain_index, std::chrono::nanoseconds(release));
+      log_entry(logger, TRACE_DEADLINE, chain_index, 0, release + chain_deadlines[chain_index] * 1000000);
+    }
+    log_entry(logger, TRACE_TIMER_RELEASE, chain_index, 0, release);
   }
+  simple_timer::TraceWriter trace_writer("experiments/results/" + experiment_name + ".trace");
   if (schedule_type == DEFAULT)
   {
     default_executor->spin();
@@ -252,47 +255,5 @@ int main(int argc, char **argv)
     sub1_executor->spin();
   }
   rclcpp::shutdown();
-
-  // combine logs from all chains
-  std::vector<std::pair<std::string, u64>> combined_logs;
-  for (auto &worker : workers)
-  {
-    for (auto &log : *(worker->logger_.recorded_times))
-    {
-      combined_logs.push_back(log);
-    }
-  }
-  for (auto &timer : timers)
-  {
-    for (auto &log : *(timer->logger_.recorded_times))
-    {
-      combined_logs.push_back(log);
-    }
-  }
-  // add logs from strategy
-  for (auto &log : *(strat->logger.recorded_times))
-  {
-    combined_logs.push_back(log);
-  }
-
-  // if using the "default" executor, grab those logs too
-  if (schedule_type == DEFAULT)
-  {
-    for (auto &log : *(default_executor->logger.recorded_times))
-    {
-      combined_logs.push_back(log);
-    }
-  }
-
-  // sort logs
-  std::sort(combined_logs.begin(), combined_logs.end(), [](const std::pair<std::string, u64> &a, const std::pair<std::string, u64> &b)
-            { return a.second < b.second; });
-
-  std::ofstream output_file;
-  output_file.open("experiments/results/" + experiment_name + ".txt");
-  for (auto p : combined_logs)
-  {
-    output_file << p.second << " " << p.first << std::endl;
-  }
-  output_file.close();
+  trace_writer.stop();
 }
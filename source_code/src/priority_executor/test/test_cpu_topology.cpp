@@ -0,0 +1,16 @@
+#include "priority_executor/cpu_topology.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(ParseCpuList, ExpandsRangesAndSingleCpus)
+{
+  EXPECT_EQ(timed_executor::parse_cpu_list("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(timed_executor::parse_cpu_list("5"), (std::vector<int>{5}));
+}
+
+TEST(ParseCpuList, SkipsEmptyAndMalformedEntries)
+{
+  EXPECT_TRUE(timed_executor::parse_cpu_list("").empty());
+  EXPECT_TRUE(timed_executor::parse_cpu_list("\n").empty());
+  EXPECT_EQ(timed_executor::parse_cpu_list("1,,x,3"), (std::vector<int>{1, 3}));
+}
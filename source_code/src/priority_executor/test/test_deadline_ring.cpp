@@ -0,0 +1,47 @@
+#include "priority_executor/deadline_ring.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(RingBuffer, RoundsTheCapacityUpToAPowerOfTwo)
+{
+  timed_executor::RingBuffer<int> ring(5);
+  EXPECT_EQ(ring.capacity(), 8u);
+}
+
+TEST(RingBuffer, PopFailsWhenEmpty)
+{
+  timed_executor::RingBuffer<int> ring(4);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(ring.size(), 0u);
+  EXPECT_FALSE(ring.pop());
+}
+
+TEST(RingBuffer, PushFailsWhenFull)
+{
+  timed_executor::RingBuffer<int> ring(4);
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_TRUE(ring.push(i));
+  }
+  EXPECT_FALSE(ring.push(4));
+  EXPECT_EQ(ring.size(), 4u);
+  EXPECT_EQ(ring.front(), 0);
+  EXPECT_EQ(ring.at(3), 3);
+  // a pop frees a slot for the next push
+  EXPECT_TRUE(ring.pop());
+  EXPECT_TRUE(ring.push(4));
+  EXPECT_EQ(ring.front(), 1);
+  EXPECT_EQ(ring.at(3), 4);
+}
+
+TEST(RingBuffer, KeepsFifoOrderAcrossTheWrap)
+{
+  timed_executor::RingBuffer<int> ring(2);
+  for (int i = 0; i < 10; ++i)
+  {
+    EXPECT_TRUE(ring.push(i));
+    EXPECT_EQ(ring.front(), i);
+    EXPECT_TRUE(ring.pop());
+  }
+  EXPECT_TRUE(ring.empty());
+}
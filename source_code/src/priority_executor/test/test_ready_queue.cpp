@@ -0,0 +1,103 @@
+#include "priority_executor/ready_queue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+  // the smaller key runs first, as PriorityExecutableComparator orders them
+  struct KeyCompare
+  {
+    const std::vector<uint64_t> *keys;
+    bool operator()(size_t a, size_t b) const
+    {
+      return (*keys)[a] > (*keys)[b];
+    }
+  };
+} // namespace
+
+TEST(MakeSortKey, OrdersByClassThenPrimaryThenTiebreak)
+{
+  using timed_executor::make_sort_key;
+  EXPECT_LT(make_sort_key(0, 1000000, 5), make_sort_key(1, 0, 0));
+  EXPECT_LT(make_sort_key(1, 10, 0xffff), make_sort_key(1, 11, 0));
+  EXPECT_LT(make_sort_key(2, 7, 1), make_sort_key(2, 7, 2));
+}
+
+TEST(MakeSortKey, SaturatesEachField)
+{
+  using timed_executor::make_sort_key;
+  const uint64_t primary_max = (uint64_t(1) << 46) - 1;
+  const uint64_t tiebreak_max = (uint64_t(1) << 16) - 1;
+  EXPECT_EQ(make_sort_key(0, UINT64_MAX, 0), make_sort_key(0, primary_max, 0));
+  EXPECT_EQ(make_sort_key(0, 0, UINT64_MAX), make_sort_key(0, 0, tiebreak_max));
+  EXPECT_EQ(make_sort_key(7, 0, 0), make_sort_key(3, 0, 0));
+  // a saturated field does not spill into the one above it
+  EXPECT_LT(make_sort_key(0, UINT64_MAX, UINT64_MAX), make_sort_key(1, 0, 0));
+  EXPECT_LT(make_sort_key(1, 3, UINT64_MAX), make_sort_key(1, 4, 0));
+}
+
+TEST(IndexedHeap, PopsInKeyOrder)
+{
+  std::vector<uint64_t> keys = {5, 3, 9, 1, 7};
+  timed_executor::IndexedHeap<KeyCompare> heap(KeyCompare{&keys});
+  for (size_t id = 0; id < keys.size(); ++id)
+  {
+    heap.push(id);
+  }
+  std::vector<size_t> order;
+  while (!heap.empty())
+  {
+    order.push_back(heap.top());
+    heap.pop();
+  }
+  EXPECT_EQ(order, (std::vector<size_t>{3, 1, 0, 4, 2}));
+}
+
+TEST(IndexedHeap, UpdateMovesAnIdAfterItsKeyChanged)
+{
+  std::vector<uint64_t> keys = {5, 3, 9, 1, 7};
+  timed_executor::IndexedHeap<KeyCompare> heap(KeyCompare{&keys});
+  for (size_t id = 0; id < keys.size(); ++id)
+  {
+    heap.push(id);
+  }
+  keys[2] = 0;
+  heap.update(2);
+  EXPECT_EQ(heap.top(), 2u);
+  keys[2] = 10;
+  heap.update(2);
+  EXPECT_EQ(heap.top(), 3u);
+  // pushing an id already in the heap only moves it
+  keys[4] = 0;
+  heap.push(4);
+  EXPECT_EQ(heap.size(), keys.size());
+  EXPECT_EQ(heap.top(), 4u);
+}
+
+TEST(IndexedHeap, RemoveTakesOutAnyId)
+{
+  std::vector<uint64_t> keys = {5, 3, 9, 1, 7};
+  timed_executor::IndexedHeap<KeyCompare> heap(KeyCompare{&keys});
+  for (size_t id = 0; id < keys.size(); ++id)
+  {
+    heap.push(id);
+  }
+  heap.remove(0);
+  heap.remove(3);
+  // removing an id that is not in the heap does nothing
+  heap.remove(3);
+  heap.remove(42);
+  EXPECT_EQ(heap.size(), 3u);
+  EXPECT_FALSE(heap.contains(0));
+  EXPECT_FALSE(heap.contains(3));
+  EXPECT_TRUE(heap.contains(2));
+  std::vector<size_t> order;
+  while (!heap.empty())
+  {
+    order.push_back(heap.top());
+    heap.pop();
+  }
+  EXPECT_EQ(order, (std::vector<size_t>{1, 4, 2}));
+}
@@ -2,6 +2,7 @@
 #define __CYCLE_TIMER__
 
 #include <memory>
+#include "simple_timer/latency_histogram.hpp"
 #include "simple_timer/rt-sched.hpp"
 namespace simple_timer
 {
@@ -13,9 +14,9 @@ namespace simple_timer
         const u64 start_delay_time;
         u64 start_time = 0;
         u64 last_cycle_time = 0;
-        unsigned long max_diff = 0;
-        unsigned long min_diff = 0;
         unsigned long last_diff = 0;
+        // cycle times in us, see LatencyHistogram::percentile()
+        LatencyHistogram cycle_times;
         bool recording = false;
     };
 } // namespace simple_timer
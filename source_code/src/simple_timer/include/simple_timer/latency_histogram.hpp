@@ -0,0 +1,100 @@
+#ifndef __LATENCY_HISTOGRAM__
+#define __LATENCY_HISTOGRAM__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace simple_timer
+{
+    /// Fixed memory histogram of latencies with a bounded relative error, in the manner of HdrHistogram.
+    /**
+     * Values below 256 are counted exactly, larger ones in 128 linear buckets
+     * per power of two, so a reported percentile is at most 1/128 above the
+     * recorded value. record() is lock-free and may be called from any number of
+     * threads; merge() adds another histogram, such as a per-thread one, in
+     * time independent of how many values it holds. The unit is the caller's.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 8;
+        static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+        static constexpr size_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+        static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+
+        LatencyHistogram();
+
+        LatencyHistogram(const LatencyHistogram &) = delete;
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+        void record(uint64_t value)
+        {
+            counts_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+            uint64_t max = max_.load(std::memory_order_relaxed);
+            while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+            {
+            }
+            uint64_t min = min_.load(std::memory_order_relaxed);
+            while (value < min && !min_.compare_exchange_weak(min, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        /// Adds the values recorded by other.
+        void merge(const LatencyHistogram &other);
+
+        void reset();
+
+        /// The value below which percent of the recorded values fall, 0 if there are none.
+        uint64_t percentile(double percent) const;
+
+        uint64_t count() const
+        {
+            return count_.load(std::memory_order_relaxed);
+        }
+
+        /// Exact, not bucketed; 0 if nothing was recorded.
+        uint64_t min() const
+        {
+            return count() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t max() const
+        {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        double mean() const
+        {
+            uint64_t n = count();
+            return n == 0 ? 0.0 : (double)sum_.load(std::memory_order_relaxed) / n;
+        }
+
+        static size_t bucket_of(uint64_t value)
+        {
+            if (value < SUB_BUCKETS)
+            {
+                return value;
+            }
+            unsigned shift = 64 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+            // value >> shift is in [HALF_SUB_BUCKETS, SUB_BUCKETS)
+            return (shift + 1) * HALF_SUB_BUCKETS + (value >> shift) - HALF_SUB_BUCKETS;
+        }
+
+        /// The largest value counted in bucket.
+        static uint64_t highest_in_bucket(size_t bucket);
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> counts_;
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> min_{UINT64_MAX};
+        std::atomic<uint64_t> max_{0};
+    };
+} // namespace simple_timer
+
+#endif
@@ -2,6 +2,7 @@
 #define __PERIOD_TIMER__
 
 #include <memory>
+#include "simple_timer/latency_histogram.hpp"
 #include "simple_timer/rt-sched.hpp"
 namespace simple_timer
 {
@@ -15,9 +16,9 @@ namespace simple_timer
         u64 start_time = 0;
 
         u64 last_period_time = 0;
-        unsigned long max_period = 0;
-        unsigned long min_period = 0;
         unsigned long last_period = 0;
+        // start to stop times in us, see LatencyHistogram::percentile()
+        LatencyHistogram periods;
         bool recording = false;
     };
 } // namespace simple_timer
@@ -13,9 +13,10 @@
 
 #include <stdint.h>
 #include <sys/types.h>
-#include <mutex>
-#include <vector>
-#include <memory>
+#include <time.h>
+
+#include "simple_timer/trace_buffer.hpp"
+#include "simple_timer/tsc_clock.hpp"
 
 #ifndef SCHED_DEADLINE
 #define SCHED_DEADLINE 6
@@ -73,26 +74,20 @@ int sched_getattr(pid_t pid,
 		  unsigned int size,
 		  unsigned int flags);
 
-u64 get_time_us(void);
-
+/* Events go to the calling thread's simple_timer::TraceBuffer, see
+   collect_trace_events(); a logger not made by create_logger() drops them. */
 typedef struct node_time_logger
 {
-	std::shared_ptr<std::vector<std::pair<std::string, u64>>> recorded_times;
+	bool enabled = false;
 } node_time_logger;
 
-void log_entry(node_time_logger logger, std::string text);
+void log_entry(node_time_logger logger, trace_event_id event, int chain, u64 instance, u64 value);
 node_time_logger create_logger();
 
+/* Microseconds of simple_timer::now_ns(). */
 inline u64 get_time_us(void)
 {
-	struct timespec ts;
-	unsigned long long time;
-
-	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-	time = ts.tv_sec * 1000000;
-	time += ts.tv_nsec / 1000;
-
-	return time;
+	return simple_timer::now_ns() / 1000;
 }
 
 #endif /* __RT_SCHED_H__ */
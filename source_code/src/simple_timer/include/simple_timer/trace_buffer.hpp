@@ -0,0 +1,131 @@
+#ifndef __TRACE_BUFFER__
+#define __TRACE_BUFFER__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// What a trace_event records, see trace_event_text() for the text each one stands for.
+/**
+ * Every time an event carries is in ns, see simple_timer::now_ns().
+ */
+enum trace_event_id : uint16_t
+{
+    // chain released, value is the release time
+    TRACE_RELEASE,
+    // last callback of the chain done, value is the completion time
+    TRACE_COMPLETE,
+    // chain timer fired, value is its release time
+    TRACE_TIMER_RELEASE,
+    // value is the absolute deadline
+    TRACE_DEADLINE,
+    // first event of every thread, value is its kernel thread id
+    TRACE_THREAD,
+    // scheduling events of the executor
+    // a chain instance released, value is its release time
+    TRACE_JOB_RELEASE,
+    // value is the absolute deadline of the released instance
+    TRACE_JOB_DEADLINE,
+    // an executable starts running, value is its absolute deadline, 0 if it has none
+    TRACE_DISPATCH_START,
+    // the executable of the last TRACE_DISPATCH_START on this thread returned
+    TRACE_DISPATCH_END,
+    // the last stage of an instance finished late, value is the deadline it missed
+    TRACE_DEADLINE_MISS,
+    // an instance was not released as too many of the chain were outstanding, value is its release time
+    TRACE_JOB_OVERFLOW,
+};
+
+/// One binary trace record, formatted only when the trace is written out.
+struct trace_event
+{
+    // ns, see simple_timer::now_ns()
+    uint64_t timestamp;
+    uint64_t instance;
+    uint64_t value;
+    int32_t chain;
+    uint16_t event;
+    // registration order of the thread that logged it
+    uint16_t thread;
+};
+
+namespace simple_timer
+{
+    /// Fixed size ring of the events logged by one thread.
+    /**
+     * Lock-free for its owning thread pushing and one thread popping; push()
+     * drops the event and counts it instead of growing when the ring is full.
+     */
+    class TraceBuffer
+    {
+    public:
+        TraceBuffer(uint16_t thread, size_t capacity);
+
+        TraceBuffer(const TraceBuffer &) = delete;
+        TraceBuffer &operator=(const TraceBuffer &) = delete;
+
+        bool push(const trace_event &event)
+        {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) > mask_)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            events_[tail & mask_] = event;
+            events_[tail & mask_].thread = thread_;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// Consumer side, moves up to count of the oldest events to out and returns how many.
+        size_t pop(trace_event *out, size_t count);
+
+        uint16_t thread() const
+        {
+            return thread_;
+        }
+
+        size_t capacity() const
+        {
+            return mask_ + 1;
+        }
+
+        /// Events lost because the ring was full.
+        uint64_t dropped() const
+        {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<size_t> head_{0};
+        std::atomic<size_t> tail_{0};
+        std::atomic<uint64_t> dropped_{0};
+        uint16_t thread_;
+        size_t mask_;
+        std::unique_ptr<trace_event[]> events_;
+    };
+
+    /// The calling thread's buffer, registered and allocated by its first call.
+    TraceBuffer &thread_trace_buffer();
+
+    /// Capacity in events of the buffers registered from now on, rounded up to a power of two.
+    void set_trace_buffer_capacity(size_t events);
+
+    /// Every buffer registered so far; they live until the process exits.
+    std::vector<TraceBuffer *> trace_buffers();
+} // namespace simple_timer
+
+/// Takes the events out of every thread's buffer, ordered by timestamp.
+std::vector<trace_event> collect_trace_events();
+
+/// The text the event stands for, such as "3 release_time: 1200".
+std::string trace_event_text(const trace_event &event);
+
+/// Events dropped by all buffers because they were full.
+uint64_t dropped_trace_events();
+
+#endif
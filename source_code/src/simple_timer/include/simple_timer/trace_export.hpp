@@ -0,0 +1,25 @@
+#ifndef __TRACE_EXPORT__
+#define __TRACE_EXPORT__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "simple_timer/trace_buffer.hpp"
+
+/// Writes events, ordered by timestamp, as Chrome trace event JSON for Perfetto or chrome://tracing.
+/**
+ * Every tracing thread is a track named after its kernel thread id, dispatches
+ * are slices on the track of the worker that ran them, releases and misses are
+ * instants; deadlines are global instants at the deadline itself.
+ */
+void write_chrome_trace(std::ostream &out, const std::vector<trace_event> &events);
+
+/// Writes events as a Common Trace Format 1.8 trace into directory, for Trace Compass or babeltrace.
+/**
+ * The directory must exist; it receives the TSDL metadata and one stream file.
+ * Returns false if either cannot be written.
+ */
+bool write_ctf_trace(const std::string &directory, const std::vector<trace_event> &events);
+
+#endif
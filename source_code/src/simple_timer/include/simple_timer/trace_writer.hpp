@@ -0,0 +1,92 @@
+#ifndef __TRACE_WRITER__
+#define __TRACE_WRITER__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simple_timer/trace_buffer.hpp"
+
+/// Start of a trace file, followed by trace_event records in the order they were drained.
+struct trace_file_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;
+    uint64_t reserved[2];
+};
+
+#define TRACE_FILE_MAGIC "RTTRACE"
+// 2: the release, completion and deadline events carry ns instead of ms
+#define TRACE_FILE_VERSION 2
+
+/// Reads a file written by simple_timer::TraceWriter, ordered by timestamp; false if it is not one.
+bool read_trace_file(const std::string &path, std::vector<trace_event> &events);
+
+namespace simple_timer
+{
+    /// Streams the trace buffers of all threads to a binary file while the process runs.
+    /**
+     * A SCHED_IDLE thread wakes up every period, takes the events out of every
+     * buffer and copies them into a memory mapped window of the file; a full
+     * window is unmapped and the next one mapped, so memory stays flat however
+     * long the run. It must be the only consumer of the buffers, do not call
+     * collect_trace_events() while it runs.
+     */
+    class TraceWriter
+    {
+    public:
+        /// Creates path and starts draining; throws std::runtime_error if it cannot be created.
+        explicit TraceWriter(const std::string &path,
+                             std::chrono::milliseconds period = std::chrono::milliseconds(100),
+                             size_t window_bytes = 16 << 20);
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter &) = delete;
+        TraceWriter &operator=(const TraceWriter &) = delete;
+
+        /// Drains what is left, truncates the file to the events written and closes it.
+        void stop();
+
+        uint64_t written() const
+        {
+            return written_.load(std::memory_order_relaxed);
+        }
+
+        /// False once mapping the file failed; later events are dropped.
+        bool ok() const
+        {
+            return !failed_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void run();
+        void drain();
+        void append(const trace_event *events, size_t count);
+        bool map_window(uint64_t offset);
+        void unmap_window();
+
+        int fd_;
+        std::chrono::milliseconds period_;
+        size_t window_bytes_;
+        char *window_ = nullptr;
+        // file offset of the window, and bytes used in it
+        uint64_t window_offset_ = 0;
+        size_t window_used_ = 0;
+        std::vector<trace_event> scratch_;
+        std::atomic<uint64_t> written_{0};
+        std::atomic<bool> failed_{false};
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopping_ = false;
+        std::thread thread_;
+    };
+} // namespace simple_timer
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef __TSC_CLOCK__
+#define __TSC_CLOCK__
+
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace simple_timer
+{
+    enum clock_mode
+    {
+        // calibration has not started, or is timing the TSC
+        CLOCK_CALIBRATING = 0,
+        CLOCK_TSC,
+        CLOCK_GETTIME
+    };
+
+    /// Conversion from TSC ticks to nanoseconds on CLOCK_MONOTONIC, published under a sequence lock.
+    struct clock_calibration
+    {
+        // odd while the fields below are being rewritten
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> mode;
+        std::atomic<uint64_t> tsc_base;
+        std::atomic<uint64_t> ns_base;
+        // nanoseconds per tick, as a 32.32 fixed point number
+        std::atomic<uint64_t> ns_per_tick;
+        // ticks past tsc_base after which the conversion is re-anchored
+        std::atomic<uint64_t> tick_limit;
+    };
+
+    // zero, i.e. CLOCK_CALIBRATING, until the first now_ns() calls calibrate it
+    extern clock_calibration clock_state;
+
+    /// Finish calibrating now instead of over the first 20 ms of now_ns() calls.
+    /**
+     * The TSC is only used when the CPU reports it invariant, i.e. constant
+     * rate and not stopped in idle states, and the kernel did not switch its
+     * clocksource away from it, e.g. after finding the cores out of sync.
+     * Otherwise now_ns() reads CLOCK_MONOTONIC. Busy-waits for up to 20 ms.
+     */
+    void calibrate_clock();
+
+    /// Slow path of now_ns(): calibrates or re-anchors the clock, or reads CLOCK_MONOTONIC.
+    uint64_t update_clock(uint64_t tsc);
+
+    /// Whether now_ns() reads the TSC rather than calling clock_gettime(); false until calibrated.
+    inline bool clock_uses_tsc()
+    {
+        return clock_state.mode.load(std::memory_order_acquire) == CLOCK_TSC;
+    }
+
+    /// A consistent copy of clock_state.
+    struct clock_snapshot
+    {
+        uint32_t mode;
+        uint64_t tsc_base;
+        uint64_t ns_base;
+        uint64_t ns_per_tick;
+        uint64_t tick_limit;
+    };
+
+    inline clock_snapshot load_clock_state()
+    {
+        clock_snapshot state;
+        uint32_t sequence;
+        do
+        {
+            sequence = clock_state.sequence.load(std::memory_order_acquire);
+            state.mode = clock_state.mode.load(std::memory_order_relaxed);
+            state.tsc_base = clock_state.tsc_base.load(std::memory_order_relaxed);
+            state.ns_base = clock_state.ns_base.load(std::memory_order_relaxed);
+            state.ns_per_tick = clock_state.ns_per_tick.load(std::memory_order_relaxed);
+            state.tick_limit = clock_state.tick_limit.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != clock_state.sequence.load(std::memory_order_relaxed));
+        return state;
+    }
+
+    /// Nanoseconds on CLOCK_MONOTONIC, the clock of every timestamp, release time and deadline.
+    /**
+     * With the TSC, the conversion is re-anchored to CLOCK_MONOTONIC about
+     * once a second, and its rate slewed so that the clock stays continuous
+     * while it follows NTP adjustments of CLOCK_MONOTONIC.
+     */
+    inline uint64_t now_ns()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        uint64_t tsc = __rdtsc();
+        clock_snapshot state = load_clock_state();
+        if (state.mode == CLOCK_TSC)
+        {
+            uint64_t ticks = tsc - state.tsc_base;
+            if (ticks < state.tick_limit)
+            {
+                __extension__ typedef unsigned __int128 u128;
+                return state.ns_base + (uint64_t)(((u128)ticks * state.ns_per_tick) >> 32);
+            }
+        }
+        if (state.mode != CLOCK_GETTIME)
+        {
+            return update_clock(tsc);
+        }
+#endif
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+} // namespace simple_timer
+
+#endif
@@ -28,14 +28,7 @@ namespace simple_timer
     else
     {
       time_diff = current_wall_time - last_cycle_time;
-      if (time_diff < min_diff || min_diff == 0)
-      {
-        min_diff = time_diff;
-      }
-      if (time_diff > max_diff || max_diff == 0)
-      {
-        max_diff = time_diff;
-      }
+      cycle_times.record(time_diff);
       last_cycle_time = current_wall_time;
       last_diff = time_diff;
     }
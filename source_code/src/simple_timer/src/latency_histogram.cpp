@@ -0,0 +1,99 @@
+#include "simple_timer/latency_histogram.hpp"
+
+#include <cmath>
+
+namespace simple_timer
+{
+  constexpr unsigned LatencyHistogram::SUB_BUCKET_BITS;
+  constexpr size_t LatencyHistogram::SUB_BUCKETS;
+  constexpr size_t LatencyHistogram::HALF_SUB_BUCKETS;
+  constexpr size_t LatencyHistogram::BUCKETS;
+
+  LatencyHistogram::LatencyHistogram()
+  {
+    for (auto &count : counts_)
+    {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void LatencyHistogram::merge(const LatencyHistogram &other)
+  {
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+      uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+      if (count != 0)
+      {
+        counts_[i].fetch_add(count, std::memory_order_relaxed);
+      }
+    }
+    count_.fetch_add(other.count_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t other_max = other.max_.load(std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (other_max > max && !max_.compare_exchange_weak(max, other_max, std::memory_order_relaxed))
+    {
+    }
+    uint64_t other_min = other.min_.load(std::memory_order_relaxed);
+    uint64_t min = min_.load(std::memory_order_relaxed);
+    while (other_min < min && !min_.compare_exchange_weak(min, other_min, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  void LatencyHistogram::reset()
+  {
+    for (auto &count : counts_)
+    {
+      count.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t LatencyHistogram::percentile(double percent) const
+  {
+    // the counts are summed again rather than trusting count_, which a
+    // concurrent record() may have bumped before its bucket
+    uint64_t total = 0;
+    for (const auto &count : counts_)
+    {
+      total += count.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+      return 0;
+    }
+    uint64_t rank = (uint64_t)std::ceil(percent / 100.0 * total);
+    if (rank == 0)
+    {
+      rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank)
+      {
+        // no recorded value is above the exact maximum
+        uint64_t highest = highest_in_bucket(i);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        return highest < max ? highest : max;
+      }
+    }
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t LatencyHistogram::highest_in_bucket(size_t bucket)
+  {
+    if (bucket < SUB_BUCKETS)
+    {
+      return bucket;
+    }
+    unsigned shift = bucket / HALF_SUB_BUCKETS - 1;
+    uint64_t lowest = (uint64_t)(bucket % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+  }
+} // namespace simple_timer
@@ -42,14 +42,7 @@ namespace simple_timer
     else
     {
       time_diff = current_wall_time - last_period_time;
-      if (time_diff < min_period || min_period == 0)
-      {
-        min_period = time_diff;
-      }
-      if (time_diff > max_period || max_period == 0)
-      {
-        max_period = time_diff;
-      }
+      periods.record(time_diff);
       last_period = time_diff;
     }
   }
@@ -30,17 +30,25 @@ int sched_getattr(pid_t pid,
 	return syscall(__NR_sched_getattr, pid, attr, size, flags);
 }
 
-void log_entry(node_time_logger logger, std::string text)
+void log_entry(node_time_logger logger, trace_event_id event, int chain, u64 instance, u64 value)
 {
-    if (logger.recorded_times != nullptr)
+    if (logger.enabled)
     {
-        logger.recorded_times->push_back(std::make_pair(text, get_time_us()));
+        // registers a new thread before its first event is timed
+        simple_timer::TraceBuffer &buffer = simple_timer::thread_trace_buffer();
+        trace_event entry;
+        entry.timestamp = simple_timer::now_ns();
+        entry.instance = instance;
+        entry.value = value;
+        entry.chain = chain;
+        entry.event = event;
+        buffer.push(entry);
     }
 }
 
 node_time_logger create_logger()
 {
     node_time_logger logger;
-    logger.recorded_times = std::make_shared<std::vector<std::pair<std::string, u64>>>();
+    logger.enabled = true;
     return logger;
-}
\ No newline at end of file
+}
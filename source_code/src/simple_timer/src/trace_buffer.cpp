@@ -0,0 +1,138 @@
+#include "simple_timer/trace_buffer.hpp"
+#include "simple_timer/rt-sched.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace simple_timer
+{
+  namespace
+  {
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> registry;
+    size_t buffer_capacity = 1 << 16;
+
+    size_t round_up(size_t capacity)
+    {
+      size_t size = 1;
+      while (size < capacity)
+      {
+        size <<= 1;
+      }
+      return size;
+    }
+  } // namespace
+
+  TraceBuffer::TraceBuffer(uint16_t thread, size_t capacity)
+      : thread_(thread), mask_(round_up(capacity) - 1), events_(new trace_event[mask_ + 1]())
+  {
+  }
+
+  size_t TraceBuffer::pop(trace_event *out, size_t count)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t available = tail_.load(std::memory_order_acquire) - head;
+    count = std::min(count, available);
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i] = events_[(head + i) & mask_];
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  TraceBuffer &thread_trace_buffer()
+  {
+    thread_local TraceBuffer *buffer = nullptr;
+    if (buffer == nullptr)
+    {
+      std::lock_guard<std::mutex> lock(registry_mutex);
+      registry.emplace_back(new TraceBuffer(registry.size(), buffer_capacity));
+      buffer = registry.back().get();
+      // names the thread in exported traces
+      trace_event thread = {};
+      thread.timestamp = simple_timer::now_ns();
+      thread.event = TRACE_THREAD;
+      thread.value = syscall(SYS_gettid);
+      buffer->push(thread);
+    }
+    return *buffer;
+  }
+
+  void set_trace_buffer_capacity(size_t events)
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer_capacity = events;
+  }
+
+  std::vector<TraceBuffer *> trace_buffers()
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::vector<TraceBuffer *> buffers;
+    for (auto &buffer : registry)
+    {
+      buffers.push_back(buffer.get());
+    }
+    return buffers;
+  }
+} // namespace simple_timer
+
+std::vector<trace_event> collect_trace_events()
+{
+  std::vector<trace_event> events;
+  for (simple_timer::TraceBuffer *buffer : simple_timer::trace_buffers())
+  {
+    size_t size = events.size();
+    events.resize(size + buffer->capacity());
+    events.resize(size + buffer->pop(events.data() + size, buffer->capacity()));
+  }
+  std::stable_sort(events.begin(), events.end(), [](const trace_event &a, const trace_event &b)
+                   { return a.timestamp < b.timestamp; });
+  return events;
+}
+
+std::string trace_event_text(const trace_event &event)
+{
+  std::string chain = std::to_string(event.chain);
+  std::string value = std::to_string(event.value);
+  switch (event.event)
+  {
+  case TRACE_RELEASE:
+    return chain + " release_time: " + value;
+  case TRACE_COMPLETE:
+    return chain + " completed_time: " + value;
+  case TRACE_TIMER_RELEASE:
+    return "timer_" + chain + "_release_" + value;
+  case TRACE_DEADLINE:
+    return "deadline_" + chain + "_" + value;
+  case TRACE_THREAD:
+    return "thread_" + std::to_string(event.thread) + " tid: " + value;
+  case TRACE_JOB_RELEASE:
+    return chain + " job_release: " + std::to_string(event.instance) + " " + value;
+  case TRACE_JOB_DEADLINE:
+    return chain + " job_deadline: " + std::to_string(event.instance) + " " + value;
+  case TRACE_DISPATCH_START:
+    return chain + " dispatch_start: " + std::to_string(event.instance) + " thread_" + std::to_string(event.thread);
+  case TRACE_DISPATCH_END:
+    return chain + " dispatch_end: " + std::to_string(event.instance) + " thread_" + std::to_string(event.thread);
+  case TRACE_DEADLINE_MISS:
+    return chain + " deadline_miss: " + std::to_string(event.instance) + " " + value;
+  case TRACE_JOB_OVERFLOW:
+    return chain + " job_overflow: " + std::to_string(event.instance) + " " + value;
+  default:
+    return "event_" + std::to_string(event.event) + "_" + chain + "_" + value;
+  }
+}
+
+uint64_t dropped_trace_events()
+{
+  uint64_t dropped = 0;
+  for (simple_timer::TraceBuffer *buffer : simple_timer::trace_buffers())
+  {
+    dropped += buffer->dropped();
+  }
+  return dropped;
+}
@@ -0,0 +1,45 @@
+// Prints a trace file written by simple_timer::TraceWriter in the text format
+// of the experiment logs: the time in microseconds, then the event. Also
+// converts it to Chrome trace JSON for Perfetto, or to a CTF trace directory.
+#include "simple_timer/trace_export.hpp"
+#include "simple_timer/trace_writer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  bool chrome = argc == 3 && std::strcmp(argv[1], "--chrome") == 0;
+  bool ctf = argc == 4 && std::strcmp(argv[1], "--ctf") == 0;
+  if (argc != 2 && !chrome && !ctf)
+  {
+    std::cerr << "usage: " << argv[0] << " [--chrome | --ctf <directory>] <trace file>" << std::endl;
+    return 1;
+  }
+  const char *path = argv[argc - 1];
+  std::vector<trace_event> events;
+  if (!read_trace_file(path, events))
+  {
+    std::cerr << path << " is not a readable trace file" << std::endl;
+    return 1;
+  }
+  if (chrome)
+  {
+    write_chrome_trace(std::cout, events);
+    return 0;
+  }
+  if (ctf)
+  {
+    if (!write_ctf_trace(argv[2], events))
+    {
+      std::cerr << "cannot write a CTF trace to " << argv[2] << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+  for (const trace_event &event : events)
+  {
+    std::cout << event.timestamp / 1000 << " " << trace_event_text(event) << "\n";
+  }
+  return 0;
+}
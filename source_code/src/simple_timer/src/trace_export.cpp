@@ -0,0 +1,175 @@
+#include "simple_timer/trace_export.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+  // CTF event names, indexed by trace_event_id
+  const char *const event_names[] = {
+      "release_time",
+      "completed_time",
+      "timer_release",
+      "deadline",
+      "thread",
+      "job_release",
+      "job_deadline",
+      "dispatch_start",
+      "dispatch_end",
+      "deadline_miss",
+      "job_overflow",
+  };
+  const size_t event_count = sizeof(event_names) / sizeof(event_names[0]);
+
+  const uint64_t no_instance = UINT64_MAX;
+
+  // microseconds, the unit of the ts field, keeping the ns digits
+  void write_us(std::ostream &out, uint64_t ns)
+  {
+    out << ns / 1000 << "." << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+  }
+
+  void write_instant(std::ostream &out, const trace_event &event, const char *name, const char *scope, uint64_t ns)
+  {
+    out << "{\"ph\":\"i\",\"s\":\"" << scope << "\",\"name\":\"" << name << " chain " << event.chain
+        << "\",\"cat\":\"job\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+    write_us(out, ns);
+    out << ",\"args\":{\"instance\":" << event.instance << "}}";
+  }
+} // namespace
+
+void write_chrome_trace(std::ostream &out, const std::vector<trace_event> &events)
+{
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"executor\"}}";
+  for (const trace_event &event : events)
+  {
+    out << ",\n";
+    switch (event.event)
+    {
+    case TRACE_THREAD:
+      out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << event.thread
+          << ",\"args\":{\"name\":\"thread " << event.thread << " (tid " << event.value << ")\"}}";
+      break;
+    case TRACE_DISPATCH_START:
+      out << "{\"ph\":\"B\",\"name\":\"chain " << event.chain << "\",\"cat\":\"dispatch\",\"pid\":1,\"tid\":"
+          << event.thread << ",\"ts\":";
+      write_us(out, event.timestamp);
+      out << ",\"args\":{";
+      if (event.instance != no_instance)
+      {
+        out << "\"instance\":" << event.instance << ",\"deadline_us\":";
+        write_us(out, event.value);
+      }
+      out << "}}";
+      break;
+    case TRACE_DISPATCH_END:
+      out << "{\"ph\":\"E\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+      write_us(out, event.timestamp);
+      out << "}";
+      break;
+    case TRACE_JOB_RELEASE:
+      write_instant(out, event, "release", "t", event.timestamp);
+      break;
+    case TRACE_JOB_DEADLINE:
+      // shown where it falls due, across every track
+      write_instant(out, event, "deadline", "g", event.value);
+      break;
+    case TRACE_DEADLINE_MISS:
+      write_instant(out, event, "deadline miss", "g", event.timestamp);
+      break;
+    case TRACE_JOB_OVERFLOW:
+      write_instant(out, event, "overflow", "t", event.timestamp);
+      break;
+    default:
+      out << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << trace_event_text(event)
+          << "\",\"cat\":\"log\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+      write_us(out, event.timestamp);
+      out << "}";
+      break;
+    }
+  }
+  out << "\n]}\n";
+}
+
+bool write_ctf_trace(const std::string &directory, const std::vector<trace_event> &events)
+{
+  uint16_t probe = 1;
+  bool little_endian = *reinterpret_cast<uint8_t *>(&probe) == 1;
+
+  std::ofstream metadata(directory + "/metadata");
+  metadata << "/* CTF 1.8 */\n\n"
+           << "typealias integer { size = 16; align = 8; signed = false; } := uint16_t;\n"
+           << "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n"
+           << "typealias integer { size = 32; align = 8; signed = true; } := int32_t;\n"
+           << "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n\n"
+           << "trace {\n"
+           << "\tmajor = 1;\n"
+           << "\tminor = 8;\n"
+           << "\tbyte_order = " << (little_endian ? "le" : "be") << ";\n"
+           << "\tpacket.header := struct {\n"
+           << "\t\tuint32_t magic;\n"
+           << "\t\tuint32_t stream_id;\n"
+           << "\t};\n"
+           << "};\n\n"
+           << "env {\n"
+           << "\ttracer_name = \"simple_timer\";\n"
+           << "};\n\n"
+           << "clock {\n"
+           << "\tname = monotonic;\n"
+           << "\tfreq = 1000000000;\n"
+           << "};\n\n"
+           << "typealias integer { size = 64; align = 8; signed = false; map = clock.monotonic.value; } := clock_t;\n\n"
+           << "stream {\n"
+           << "\tid = 0;\n"
+           << "\tevent.header := struct {\n"
+           << "\t\tuint16_t id;\n"
+           << "\t\tclock_t timestamp;\n"
+           << "\t};\n"
+           << "};\n";
+  for (size_t id = 0; id < event_count; ++id)
+  {
+    metadata << "\nevent {\n"
+             << "\tname = \"" << event_names[id] << "\";\n"
+             << "\tid = " << id << ";\n"
+             << "\tstream_id = 0;\n"
+             << "\tfields := struct {\n"
+             << "\t\tint32_t chain;\n"
+             << "\t\tuint16_t thread;\n"
+             << "\t\tuint64_t instance;\n"
+             << "\t\tuint64_t value;\n"
+             << "\t};\n"
+             << "};\n";
+  }
+  metadata.close();
+
+  // a single packet without context, it spans the whole stream file
+  std::ofstream stream(directory + "/stream_0", std::ios::binary);
+  uint32_t header[2] = {0xC1FC1FC1, 0};
+  stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (const trace_event &event : events)
+  {
+    if (event.event >= event_count)
+    {
+      continue;
+    }
+    char record[32];
+    char *field = record;
+    auto put = [&field](const void *value, size_t size)
+    {
+      std::memcpy(field, value, size);
+      field += size;
+    };
+    put(&event.event, sizeof(event.event));
+    put(&event.timestamp, sizeof(event.timestamp));
+    put(&event.chain, sizeof(event.chain));
+    put(&event.thread, sizeof(event.thread));
+    put(&event.instance, sizeof(event.instance));
+    put(&event.value, sizeof(event.value));
+    stream.write(record, field - record);
+  }
+  stream.close();
+  return metadata.good() && stream.good();
+}
@@ -0,0 +1,180 @@
+#include "simple_timer/trace_writer.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// records never straddle two windows
+static_assert(sizeof(trace_file_header) == sizeof(trace_event), "trace file header must be one record long");
+static_assert(sizeof(trace_event) == 32, "trace_event is written as is");
+
+bool read_trace_file(const std::string &path, std::vector<trace_event> &events)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  trace_file_header header;
+  bool valid = fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(header) &&
+               pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+               std::memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) == 0 &&
+               header.version == TRACE_FILE_VERSION && header.event_size == sizeof(trace_event);
+  if (valid)
+  {
+    size_t count = (info.st_size - sizeof(header)) / sizeof(trace_event);
+    events.resize(count);
+    size_t bytes = count * sizeof(trace_event);
+    valid = pread(fd, events.data(), bytes, sizeof(header)) == (ssize_t)bytes;
+  }
+  close(fd);
+  if (!valid)
+  {
+    events.clear();
+    return false;
+  }
+  std::stable_sort(events.begin(), events.end(), [](const trace_event &a, const trace_event &b)
+                   { return a.timestamp < b.timestamp; });
+  return true;
+}
+
+namespace simple_timer
+{
+  TraceWriter::TraceWriter(const std::string &path, std::chrono::milliseconds period, size_t window_bytes)
+      : period_(period), scratch_(4096)
+  {
+    size_t page = sysconf(_SC_PAGESIZE);
+    window_bytes_ = std::max(page, (window_bytes + page - 1) / page * page);
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+      throw std::runtime_error("cannot create trace file " + path + ": " + std::strerror(errno));
+    }
+    if (!map_window(0))
+    {
+      close(fd_);
+      throw std::runtime_error("cannot map trace file " + path + ": " + std::strerror(errno));
+    }
+    trace_file_header header = {};
+    std::memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+    header.version = TRACE_FILE_VERSION;
+    header.event_size = sizeof(trace_event);
+    std::memcpy(window_, &header, sizeof(header));
+    window_used_ = sizeof(header);
+    thread_ = std::thread(&TraceWriter::run, this);
+  }
+
+  TraceWriter::~TraceWriter()
+  {
+    stop();
+  }
+
+  void TraceWriter::stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_)
+      {
+        return;
+      }
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    drain();
+    uint64_t size = window_offset_ + window_used_;
+    unmap_window();
+    if (ftruncate(fd_, size) != 0)
+    {
+      failed_.store(true, std::memory_order_relaxed);
+    }
+    close(fd_);
+  }
+
+  void TraceWriter::run()
+  {
+    // only runs when the cores have nothing else to do
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+      wake_.wait_for(lock, period_);
+      lock.unlock();
+      drain();
+      lock.lock();
+    }
+  }
+
+  void TraceWriter::drain()
+  {
+    for (TraceBuffer *buffer : trace_buffers())
+    {
+      size_t count;
+      while ((count = buffer->pop(scratch_.data(), scratch_.size())) > 0)
+      {
+        append(scratch_.data(), count);
+      }
+    }
+  }
+
+  void TraceWriter::append(const trace_event *events, size_t count)
+  {
+    while (count > 0 && !failed_.load(std::memory_order_relaxed))
+    {
+      if (window_used_ == window_bytes_)
+      {
+        uint64_t next = window_offset_ + window_bytes_;
+        unmap_window();
+        if (!map_window(next))
+        {
+          failed_.store(true, std::memory_order_relaxed);
+          return;
+        }
+      }
+      size_t fit = std::min(count, (window_bytes_ - window_used_) / sizeof(trace_event));
+      std::memcpy(window_ + window_used_, events, fit * sizeof(trace_event));
+      window_used_ += fit * sizeof(trace_event);
+      written_.fetch_add(fit, std::memory_order_relaxed);
+      events += fit;
+      count -= fit;
+    }
+  }
+
+  bool TraceWriter::map_window(uint64_t offset)
+  {
+    if (ftruncate(fd_, offset + window_bytes_) != 0)
+    {
+      return false;
+    }
+    void *window = mmap(nullptr, window_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+    if (window == MAP_FAILED)
+    {
+      return false;
+    }
+    window_ = static_cast<char *>(window);
+    window_offset_ = offset;
+    window_used_ = 0;
+    return true;
+  }
+
+  void TraceWriter::unmap_window()
+  {
+    if (window_ != nullptr)
+    {
+      // start the write back now rather than when the kernel gets to it
+      msync(window_, window_used_, MS_ASYNC);
+      munmap(window_, window_bytes_);
+      window_ = nullptr;
+    }
+  }
+} // namespace simple_timer
@@ -0,0 +1,203 @@
+#include "simple_timer/tsc_clock.hpp"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace simple_timer
+{
+  clock_calibration clock_state;
+
+  namespace
+  {
+    uint64_t monotonic_ns()
+    {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // held by the writer of clock_state and of the samples below
+    std::mutex update_mutex;
+
+    __extension__ typedef unsigned __int128 u128;
+    __extension__ typedef __int128 i128;
+
+    const uint64_t calibration_ns = 20000000;
+    const uint64_t reanchor_ns = 1000000000;
+    // an error past this is stepped away rather than slewed
+    const int64_t max_slew_ns = 1000000;
+
+    bool calibration_started = false;
+    // the last TSC reading paired with CLOCK_MONOTONIC, the start of the next rate measurement
+    uint64_t sample_tsc;
+    uint64_t sample_ns;
+
+    bool tsc_is_invariant()
+    {
+      unsigned int eax, ebx, ecx, edx;
+      if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+      {
+        return false;
+      }
+      __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+      if ((edx & (1u << 8)) == 0)
+      {
+        return false;
+      }
+      // the kernel drops the TSC as its clocksource when it finds it unreliable
+      std::ifstream clocksource("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+      std::string name;
+      return !(clocksource >> name) || name == "tsc";
+    }
+
+    // a TSC reading taken at the same time as ns, from the tightest of a few tries
+    void sample(uint64_t &tsc, uint64_t &ns)
+    {
+      uint64_t best = UINT64_MAX;
+      for (int i = 0; i < 8; ++i)
+      {
+        uint64_t before = __rdtsc();
+        uint64_t now = monotonic_ns();
+        uint64_t after = __rdtsc();
+        if (after - before < best)
+        {
+          best = after - before;
+          tsc = before + (after - before) / 2;
+          ns = now;
+        }
+      }
+    }
+
+    uint64_t to_ns(const clock_snapshot &state, uint64_t tsc)
+    {
+      // another core may read a TSC slightly behind the one that re-anchored
+      if ((int64_t)(tsc - state.tsc_base) < 0)
+      {
+        return state.ns_base;
+      }
+      return state.ns_base + (uint64_t)(((u128)(tsc - state.tsc_base) * state.ns_per_tick) >> 32);
+    }
+
+    void publish(uint32_t mode, uint64_t tsc_base, uint64_t ns_base, uint64_t ns_per_tick)
+    {
+      uint32_t sequence = clock_state.sequence.load(std::memory_order_relaxed);
+      clock_state.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      clock_state.mode.store(mode, std::memory_order_relaxed);
+      clock_state.tsc_base.store(tsc_base, std::memory_order_relaxed);
+      clock_state.ns_base.store(ns_base, std::memory_order_relaxed);
+      clock_state.ns_per_tick.store(ns_per_tick, std::memory_order_relaxed);
+      clock_state.tick_limit.store(ns_per_tick ? ((u128)reanchor_ns << 32) / ns_per_tick : 0, std::memory_order_relaxed);
+      clock_state.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // takes the first sample, and once calibration_ns have passed the second; with wait, without returning in between
+    void advance_calibration(bool wait)
+    {
+      if (!calibration_started)
+      {
+        calibration_started = true;
+        if (!tsc_is_invariant())
+        {
+          publish(CLOCK_GETTIME, 0, 0, 0);
+          return;
+        }
+        sample(sample_tsc, sample_ns);
+      }
+      while (monotonic_ns() - sample_ns < calibration_ns)
+      {
+        if (!wait)
+        {
+          return;
+        }
+      }
+      uint64_t end_tsc, end_ns;
+      sample(end_tsc, end_ns);
+      uint64_t ticks = end_tsc - sample_tsc;
+      uint64_t ns = end_ns - sample_ns;
+      // between 100 MHz and 10 GHz, anything else is a broken measurement
+      if (end_tsc > sample_tsc && ticks > ns / 10 && ticks < ns * 10)
+      {
+        publish(CLOCK_TSC, end_tsc, end_ns, (ns << 32) / ticks);
+        sample_tsc = end_tsc;
+        sample_ns = end_ns;
+      }
+      else
+      {
+        publish(CLOCK_GETTIME, 0, 0, 0);
+      }
+    }
+
+    // restarts the conversion at the clock's current reading, with the rate
+    // measured since the last anchor, corrected to catch up with CLOCK_MONOTONIC
+    // by the next one
+    void reanchor(const clock_snapshot &state)
+    {
+      uint64_t tsc, ns;
+      sample(tsc, ns);
+      if (tsc <= sample_tsc)
+      {
+        return;
+      }
+      uint64_t ns_per_tick = ((u128)(ns - sample_ns) << 32) / (tsc - sample_tsc);
+      uint64_t current = to_ns(state, tsc);
+      int64_t error = (int64_t)(ns - current);
+      if (error > max_slew_ns || error < -max_slew_ns)
+      {
+        publish(CLOCK_TSC, tsc, ns, ns_per_tick);
+      }
+      else
+      {
+        publish(CLOCK_TSC, tsc, current, (uint64_t)((i128)ns_per_tick * ((int64_t)reanchor_ns + error) / (int64_t)reanchor_ns));
+      }
+      sample_tsc = tsc;
+      sample_ns = ns;
+    }
+#endif
+  } // namespace
+
+  void calibrate_clock()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    std::lock_guard<std::mutex> lock(update_mutex);
+    if (load_clock_state().mode == CLOCK_CALIBRATING)
+    {
+      advance_calibration(true);
+    }
+#endif
+  }
+
+  uint64_t update_clock(uint64_t tsc)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    // whoever holds the lock is updating the clock; read it as it stands meanwhile
+    std::unique_lock<std::mutex> lock(update_mutex, std::try_to_lock);
+    clock_snapshot state = load_clock_state();
+    if (lock.owns_lock())
+    {
+      if (state.mode == CLOCK_CALIBRATING)
+      {
+        advance_calibration(false);
+      }
+      else if (state.mode == CLOCK_TSC && (int64_t)(tsc - state.tsc_base) >= (int64_t)state.tick_limit)
+      {
+        reanchor(state);
+      }
+    }
+    if (state.mode == CLOCK_TSC)
+    {
+      // from the conversion tsc was read under, never ahead of the re-anchored clock
+      return to_ns(state, tsc);
+    }
+#else
+    (void)tsc;
+#endif
+    return monotonic_ns();
+  }
+} // namespace simple_timer
@@ -0,0 +1,47 @@
+#include "simple_timer/latency_histogram.hpp"
+
+#include <gtest/gtest.h>
+
+using simple_timer::LatencyHistogram;
+
+TEST(LatencyHistogram, CountsSmallValuesExactly)
+{
+  for (uint64_t value = 0; value < LatencyHistogram::SUB_BUCKETS; ++value)
+  {
+    EXPECT_EQ(LatencyHistogram::bucket_of(value), value);
+    EXPECT_EQ(LatencyHistogram::highest_in_bucket(value), value);
+  }
+}
+
+TEST(LatencyHistogram, BucketsBoundTheRelativeError)
+{
+  const uint64_t values[] = {256, 257, 1000, 123456, 999999999, uint64_t(1) << 40, UINT64_MAX};
+  for (uint64_t value : values)
+  {
+    size_t bucket = LatencyHistogram::bucket_of(value);
+    ASSERT_LT(bucket, LatencyHistogram::BUCKETS);
+    uint64_t highest = LatencyHistogram::highest_in_bucket(bucket);
+    EXPECT_GE(highest, value);
+    EXPECT_LE(highest - value, value / LatencyHistogram::HALF_SUB_BUCKETS);
+    // the next value up starts the following bucket
+    if (highest != UINT64_MAX)
+    {
+      EXPECT_EQ(LatencyHistogram::bucket_of(highest + 1), bucket + 1);
+    }
+  }
+}
+
+TEST(LatencyHistogram, ReportsPercentilesOfTheRecordedValues)
+{
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.percentile(50), 0u);
+  for (uint64_t value = 1; value <= 100; ++value)
+  {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.count(), 100u);
+  EXPECT_EQ(histogram.min(), 1u);
+  EXPECT_EQ(histogram.max(), 100u);
+  EXPECT_EQ(histogram.percentile(50), 50u);
+  EXPECT_EQ(histogram.percentile(100), 100u);
+}